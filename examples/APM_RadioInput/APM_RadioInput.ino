@@ -1,4 +1,3 @@
-#include "Wire.h"
 #include "SPI.h"
 #include "MINDS-i-Drone.h"
 
@@ -10,10 +9,18 @@ void setup(){
 void loop(){
     static auto timer = Interval::every(100);
     if(timer()){
-        for(int i=0; i<8; i++){
+        for(int i=0; i<APMRadio::MAX_CHANNELS; i++){
             Serial.print(APMRadio::get(i));
             Serial.print(" ");
         }
+        Serial.print("| ch ");
+        Serial.print(APMRadio::channels());
+        Serial.print(" rate ");
+        Serial.print(APMRadio::frameRate());
+        Serial.print(" lost ");
+        Serial.print(APMRadio::lostFrames());
+        Serial.print(" age ");
+        Serial.print(APMRadio::frameAge());
         Serial.println();
     }
 }
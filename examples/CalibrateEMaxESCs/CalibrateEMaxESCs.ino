@@ -1,6 +1,5 @@
 #define Output_t EMaxESC
 
-#include "Wire.h"
 #include "SPI.h"
 #include "MINDS-i-Drone.h"
 #include "platforms/Quadcopter.h"
@@ -11,4 +10,5 @@ void setup(){
     output.disable();
 }
 void loop(){
+    output.updateArming();
 }
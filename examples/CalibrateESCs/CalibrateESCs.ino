@@ -1,4 +1,3 @@
-#include "Wire.h"
 #include "SPI.h"
 #include "MINDS-i-Drone.h"
 #include "platforms/Quadcopter.h"
@@ -9,4 +8,5 @@ void setup(){
     output.disable();
 }
 void loop(){
+    output.updateArming();
 }
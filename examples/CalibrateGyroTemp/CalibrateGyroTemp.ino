@@ -0,0 +1,168 @@
+#include "SPI.h"
+#include "MINDS-i-Drone.h"
+
+const uint32_t SAMPLE_DELAY  = 10;  //milliseconds between raw readings
+const uint16_t BATCH_SIZE    = 200; //readings averaged into each fit point
+const int16_t  MOTION_LIMIT  = 100; //raw gyro spread that discards a batch
+const float    MIN_SPAN      = 8.0; //celsius covered before offering to save
+const char startMessage[] = "\
+Hello! \n\
+This sketch measures how your APM2's gyroscope drifts as it warms up. \n\
+Start with the board cold, set it down somewhere it will not be bumped, \n\
+and leave it powered. Each line shows the current temperature and the \n\
+drift per degree fit so far. Once the temperature has risen by at least \n\
+8 degrees you will be asked to save the result; send any key to stop early.";
+
+MPU6000     mpu;
+Settings    set(eeStorage::getInstance());
+GyroTempFit fit;
+
+float    gyroSum[3];
+float    tempSum;
+int16_t  gyroMin[3], gyroMax[3];
+uint16_t batchCount;
+bool     offered;
+
+void setup(){
+    Serial.begin(9600);
+    mpu.begin();
+    delay(250);
+
+    auto mpuState = mpu.status();
+    if(!mpuState.good()){
+        Serial.println("Bad MPU6000 status");
+        Serial.println(mpuState.message);
+        while(true);
+    }
+
+    Serial.println(startMessage);
+    resetBatch();
+}
+
+void loop(){
+    static uint32_t time = millis();
+    if(millis() > time){
+        time += SAMPLE_DELAY;
+        if(sample()) finishBatch();
+    }
+
+    if(Serial.available()){
+        burnInput();
+        offerSave();
+    }
+}
+
+void resetBatch(){
+    batchCount = 0;
+    tempSum = 0;
+    for(int i=0; i<3; i++){
+        gyroSum[i] = 0;
+        gyroMin[i] = 0x7fff;
+        gyroMax[i] = -0x7fff;
+    }
+}
+
+/** Take a raw reading; returns true when the batch is full */
+bool sample(){
+    int16_t accl[3], gyro[3], temp;
+    mpu.getSensors(accl, gyro, temp);
+
+    tempSum += MPU6000::celsiusFromRaw(temp);
+    for(int i=0; i<3; i++){
+        gyroSum[i] += gyro[i];
+        gyroMin[i] = min(gyroMin[i], gyro[i]);
+        gyroMax[i] = max(gyroMax[i], gyro[i]);
+    }
+    batchCount++;
+    return batchCount >= BATCH_SIZE;
+}
+
+void finishBatch(){
+    for(int i=0; i<3; i++){
+        if(gyroMax[i]-gyroMin[i] > MOTION_LIMIT){
+            Serial.println("Movement detected; discarding the last reading");
+            resetBatch();
+            return;
+        }
+    }
+
+    float gyro[3];
+    for(int i=0; i<3; i++) gyro[i] = gyroSum[i]/batchCount;
+    float temp = tempSum/batchCount;
+    fit.add(temp, gyro);
+    resetBatch();
+
+    GyroTempTune tune = fit.fit();
+    Serial.print("Temp: ");
+    Serial.print(temp, 2);
+    Serial.print("\tSpan: ");
+    Serial.print(fit.span(), 2);
+    Serial.print("\tSlope x,y,z: ");
+    for(int i=0; i<3; i++){
+        Serial.print(tune.slope[i], 4);
+        Serial.print("\t");
+    }
+    Serial.println();
+
+    if(!offered && fit.span() >= MIN_SPAN){
+        offered = true;
+        offerSave();
+    }
+}
+
+void offerSave(){
+    GyroTempTune tune = fit.fit();
+    Serial.println("bias = shift + slope*(temp-reference)");
+    Serial.print("Shift x,y,z: ");
+    for(int i=0; i<3; i++){
+        Serial.print(tune.shift[i], 2);
+        Serial.print("\t");
+    }
+    Serial.println();
+    Serial.print("Slope x,y,z: ");
+    for(int i=0; i<3; i++){
+        Serial.print(tune.slope[i], 4);
+        Serial.print("\t");
+    }
+    Serial.println();
+    Serial.print("Reference: ");
+    Serial.println(tune.refTemp, 2);
+    if(fit.span() < MIN_SPAN){
+        Serial.println("Warning: the temperature has not changed much yet");
+    }
+    Serial.println("Would you like to save these values? (y/n)");
+    if(getTrueFalseResponse()){
+        set.writeGyroTempTune(tune);
+        Serial.println("Saved");
+    }
+}
+
+void burnInput(){
+    delay(10);
+    while(Serial.available()){
+        Serial.read();
+        delay(1);
+    }
+}
+
+boolean getTrueFalseResponse(){
+    Serial.print("\nEnter response [y]es, [n]o: ");
+    while(true){
+        if(Serial.available()){
+            char input = Serial.read();
+            burnInput(); //extra should be ignored
+            Serial.println();
+            switch(input){
+                case 'y':
+                case 'Y':
+                    return true;
+                case 'n':
+                case 'N':
+                    return false;
+                default:
+                    Serial.print("\nInvalid input; try again [y]es, [n]o: ");
+                    break;
+            }
+        }
+    }
+}
@@ -1,5 +1,4 @@
 #include "SPI.h"
-#include "Wire.h"
 #include "MINDSi.h"
 #include "Encoder.h"
 #include "MINDS-i-Drone.h"
@@ -38,12 +37,12 @@ HLA 			roll ( 100, 0);
 PIDparameters   cruisePID(0,0,0,-90,90);
 PIDcontroller   cruise(&cruisePID);
 ServoGenerator::Servo servo[3]; //drive, steer, backSteer
-		//scheduler, navigation, obstacle, stop times
-uint32_t uTime = 0, nTime = 0, oTime = 0, sTime = 0;
+		//navigation, obstacle, stop times
+uint32_t nTime = 0, oTime = 0, sTime = 0;
 uint32_t gpsHalfTime = 0, gpsTime = 0;
  int32_t Ax,Ay,Az; //used in accelerometer calculations
 uint16_t ping[5] = {20000,20000,20000,20000,20000};
-uint8_t  sIter,pIter; //iterators for scheduler and ping
+uint8_t  pIter; //iterator for ping
 double   pathHeading; //All Headings are Clockwise+, -179 to 180, 0=north
 double   trueHeading;
 double   gyroHalf; //Store Gyro Heading halfway between gps points
@@ -51,15 +50,14 @@ double   distance;
 boolean  stop = true;
 boolean  backDir;
 
+void navigate();
 void checkPing();
 void readAccelerometer();
 void reportLocation();
 void extrapPosition();
-void (*schedule[])(void) = {	extrapPosition,
-								checkPing,
-								readAccelerometer,
-								reportLocation,
-								};
+void sendReport();
+LoopScheduler scheduler;
+void setupSchedule();
 
 //These parameters are loaded from eeprom if the code has not been reuploaded
 //since when they were last set.
@@ -99,20 +97,14 @@ void setup() {
 		encoder::begin(EncoderPin[0], EncoderPin[1]);
 	#endif
 	manager.requestResync();
-	uTime = millis();
+	setupSchedule();
 }
 
 void loop(){
 	manager.update();
 	updateGPS();
 	updateGyro();
-	if(uTime <= millis()){
-		uTime += ScheduleDelay;
-		schedule[sIter]();
-		sIter++;
-		sIter = sIter%(sizeof(schedule)/sizeof(*schedule));
-		navigate();
-	}
+	scheduler.run();
 }
 
 void navigate(){
@@ -426,3 +418,29 @@ void setupSettings(){
 	settings.attach(15, 90, callback<int, &steerCenter>);
 }
 
+//index of the next scheduler task to report after a PROFILE_REPORT command
+uint8_t nextReportLine = LoopScheduler::MAX_TASKS;
+//sends one task's timing per run, so the serial port can drain between lines
+void sendReport(){
+	if(nextReportLine >= scheduler.size()) return;
+	char line[64];
+	if(scheduler.statsLine(nextReportLine++, line, sizeof(line)) != 0)
+		manager.sendString(line);
+}
+
+//navigate runs every ScheduleDelay; the rest take turns in the slots between
+void setupSchedule(){
+	scheduler.add(navigate, ScheduleDelay, 0, 0);
+	LoopScheduler::Task turns[] = {	extrapPosition,
+									checkPing,
+									readAccelerometer,
+									reportLocation,
+									};
+	const uint8_t count = sizeof(turns)/sizeof(*turns);
+	for(uint8_t i=0; i<count; i++){
+		scheduler.add(turns[i], ScheduleDelay*count, 1, ScheduleDelay*i);
+	}
+	scheduler.add(sendReport, 200, 2);
+	scheduler.begin();
+	manager.setProfileCallback([](){ nextReportLine = 0; });
+}
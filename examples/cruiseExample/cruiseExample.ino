@@ -1,5 +1,4 @@
 #include "SPI.h"
-#include "Wire.h"
 #include "MINDSi.h"
 #include "Encoder.h"
 #include "MINDS-i-Drone.h"
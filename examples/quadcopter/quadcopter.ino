@@ -1,4 +1,3 @@
-#include "Wire.h"
 #include "SPI.h"
 #include "MINDS-i-Drone.h"
 #include "platforms/Quadcopter.h"
@@ -13,20 +12,20 @@ const float CENTER_RATIO = 0.1f; // 1/2 percentage of stick considered centered
 
 // Time constants in milliseconds
 const uint32_t ARMING_TIME = 2000;
-const uint32_t CALIBRATING_TIME = 2000;
+const uint32_t CALIBRATING_TIMEOUT = 10000;
 const uint32_t DISARMING_TIME = 750;
 
 // State timer used to detect ARMING
 StateTimer radioDownRight([](){
-    bool down  = APMRadio::get(RADIO_THROTTLE) <= CHANNEL_TRIGGER_MIN;
-    bool right = APMRadio::get(RADIO_YAW)      <= CHANNEL_TRIGGER_MIN;
+    bool down  = Radio::get(RADIO_THROTTLE) <= CHANNEL_TRIGGER_MIN;
+    bool right = Radio::get(RADIO_YAW)      <= CHANNEL_TRIGGER_MIN;
     return down && right;
 });
 
 // State timer used to detect DISARMING
 StateTimer radioDownLeft([](){
-    bool down  = APMRadio::get(RADIO_THROTTLE) <= CHANNEL_TRIGGER_MIN;
-    bool left  = APMRadio::get(RADIO_YAW)      >= CHANNEL_TRIGGER_MAX;
+    bool down  = Radio::get(RADIO_THROTTLE) <= CHANNEL_TRIGGER_MIN;
+    bool left  = Radio::get(RADIO_YAW)      >= CHANNEL_TRIGGER_MAX;
     return down && left;
 });
 
@@ -44,20 +43,28 @@ void setState(State s){
     comms.sendString(stateString[s]);
 }
 
+// Periodic main loop work, registered in setupSchedule
+LoopScheduler scheduler;
+const uint16_t CONTROL_PERIOD = 10;
+// microseconds the loop idles for when no task is due; the CPULOAD reading
+// counts every pass that doesn't idle as busy, so it shifts with this
+const uint16_t IDLE_TIME = 200;
+void setupSchedule();
+
 void setup() {
     beginMultirotor();
     setState(DISARMED);
+    setupSchedule();
 }
 
-float averageInterval = 0.0;
 void loop() {
-    toc(1);
-    uint32_t loopUpdateTime = profileTime(1);
-    averageInterval = 0.01*loopUpdateTime + 0.99*averageInterval;
-    tic(1);
+    // time from each loop start to the next
+    toc(PROFILE_LOOP);
+    tic(PROFILE_LOOP);
     //always running updates
     updateMultirotor();
-    sendTelemetry();
+    // spare time is counted as idle to measure the processor load
+    if(!scheduler.run()) CpuLoad::idle(IDLE_TIME);
     //flight mode state machine
     switch(state){
         /*#DISARMED Hold Down and to the right on
@@ -65,8 +72,14 @@ void loop() {
         **/
         case DISARMED:
             if(radioDownRight.trueFor(ARMING_TIME)) {
-                if(safe() && !power.isBatteryLow()){
-                    calibrateEndTimer = Interval::elapsed(CALIBRATING_TIME);
+                if(!ready()){
+                    /*#STARTING The sensors are still starting up or the ESCs
+                     * are still arming; try again once the arming progress
+                     * reaches 100%
+                    **/
+                    comms.sendString("STARTING");
+                } else if(safe() && !power.isBatteryLow()){
+                    calibrateEndTimer = Interval::elapsed(CALIBRATING_TIMEOUT);
                     setState(CALIBRATE);
                 } else {
                     /*#NOFLY Flight aborted due to error status */
@@ -75,24 +88,32 @@ void loop() {
             }
             break;
         /*#CALIBRATE Calibrating the gyroscope.
-         * This lasts for two seconds. Keep the quadcopter as still as possible.
+         * This finishes once the gyroscope readings are steady, usually in
+         * under a second. Keep the quadcopter as still as possible;
+         * movement restarts the calibration.
         **/
         case CALIBRATE:
             orientation.calibrate(true);
-            if(calibrateEndTimer()) {
+            if(orientation.calibrated()) {
                 orientation.calibrate(false);
                 yawTarget = orientation.getYaw();
                 output.standby();
                 positionHold.setTarget(gps.getLocation());
                 setState(FLYING);
                 sendHomeLocation();
+            } else if(calibrateEndTimer()) {
+                orientation.calibrate(false);
+                /*#CALFAIL Gyroscope calibration timed out; the quadcopter
+                 * kept moving. Set it down somewhere still and arm again
+                **/
+                comms.sendString("CALFAIL");
+                setState(DISARMED);
             }
             break;
         /*#FLYING
          * Hold down and to the left on the throttle stick to disarm
         **/
         case FLYING:
-            fly();
             if(radioDownLeft.trueFor(DISARMING_TIME)) {
                 output.disable();
                 setState(DISARMED);
@@ -102,23 +123,32 @@ void loop() {
          * Auto-landing; Radio signal loss detected
         **/
         case FAILSAFE:
-            land();
             break;
     }
 }
 
+void fly();
+void land();
+// runs every CONTROL_PERIOD milliseconds
+void control(){
+    if(state == FLYING) fly();
+    else if(state == FAILSAFE) land();
+}
+
+// radio channel `ch` in [-1,1] after the "Stick Expo" curve
+float stick(uint8_t ch){
+    return stickCurve.apply(((float)Radio::get(ch)-90)/90.0);
+}
+
 boolean assistedMode = false;
 boolean gpsStabilization = false;
 float altitudeSetpoint;
 float outputPitch, outputRoll, outputThrottle;
 
 void fly(){
-    static auto timer = Interval::every(10);
-    if(!timer()) return;
+    uint8_t radioBaseThrottle = Radio::get(RADIO_THROTTLE);
 
-    uint8_t radioBaseThrottle = APMRadio::get(RADIO_THROTTLE);
-
-    if(radioBaseThrottle == 0) {
+    if(radioBaseThrottle == 0 || Radio::signalLost()) {
         // radio disconnect failsafe
         altitudeSetpoint = altitude.getAltitude();
         setState(FAILSAFE);
@@ -132,11 +162,11 @@ void fly(){
     output.enable();
 
     // read radio controls
-    float pitchCmd = ((float)APMRadio::get(RADIO_PITCH)-90) /-70.0;
-    float rollCmd  = ((float)APMRadio::get(RADIO_ROLL)-90)  /-70.0;
-    float yawCmd   = ((float)APMRadio::get(RADIO_YAW)-90)   /-90.0;
+    float pitchCmd = stick(RADIO_PITCH) * 90/-70.0;
+    float rollCmd  = stick(RADIO_ROLL)  * 90/-70.0;
+    float yawCmd   = -stick(RADIO_YAW);
     float throttle = ((float)radioBaseThrottle-25)/130.0;
-    bool altSwitch = (APMRadio::get(RADIO_GEAR) > 90);
+    bool altSwitch = (Radio::get(RADIO_GEAR) > 90);
 
     // Calculate time delta
     static uint32_t lastRunTime = micros();
@@ -209,15 +239,12 @@ void fly(){
 }
 
 void land(){
-    static auto timer = Interval::every(10);
-    if(!timer()) return;
-
     static bool landed = false;
 
     if(landed){
         output.disable();
     } else {
-        altitudeSetpoint -= autolandDescentRate/(1e2/*interval in seconds*/);
+        altitudeSetpoint -= autolandDescentRate*(CONTROL_PERIOD/1e3);
         outputThrottle = altitudeHold.update(altitudeSetpoint, altitude);
         horizon.set(0, 0, yawTarget, outputThrottle);
         if(altitudeHold.landingDetected()) landed = true;
@@ -230,34 +257,110 @@ void sendHomeLocation(){
     comms.sendTelem(Protocol::HOMEALTITUDE, altitude.getAltitude());
 }
 
-typedef float (*telemLine)(void);
+typedef float (*telemFunc)(void);
+struct telemLine{
+    uint8_t   id;
+    telemFunc get;
+};
+// sent continuously for the ground station's flight display
 const telemLine telemetryTable[] = {
-    [](){ return gps.getLatitude(); },             //LATITUDE
-    [](){ return gps.getLongitude(); },            //LONGITUDE
-    [](){ return toDeg(orientation.getYaw()); },   //HEADING
-    [](){ return toDeg(orientation.getPitch()); }, //PITCH
-    [](){ return toDeg(orientation.getRoll()); },  //ROLL
-    [](){ return gps.getGroundSpeed(); },          //GROUNDSPEED
-    [](){ return power.getVoltage(); },            //VOLTAGE
-    [](){ return power.getAmperage(); },           //AMPERAGE
-    [](){ return altitude.getAltitude(); },        //ALTITUDE
-    [](){ return (float)APMRadio::get(RADIO_THROTTLE); },
-    [](){ return (float)APMRadio::get(RADIO_PITCH); },
-    [](){ return (float)APMRadio::get(RADIO_ROLL); },
-    [](){ return (float)APMRadio::get(RADIO_YAW); },
-    [](){ return (float)APMRadio::get(RADIO_GEAR); },
+    {Protocol::LATITUDE,    [](){ return gps.getLatitude(); }},
+    {Protocol::LONGITUDE,   [](){ return gps.getLongitude(); }},
+    {Protocol::HEADING,     [](){ return toDeg(orientation.getYaw()); }},
+    {Protocol::PITCH,       [](){ return toDeg(orientation.getPitch()); }},
+    {Protocol::ROLL,        [](){ return toDeg(orientation.getRoll()); }},
+    {Protocol::GROUNDSPEED, [](){ return gps.getGroundSpeed(); }},
+    {Protocol::VOLTAGE,     [](){ return power.getVoltage(); }},
+    {Protocol::AMPERAGE,    [](){ return power.getAmperage(); }},
+    {Protocol::ALTITUDE,    [](){ return altitude.getAltitude(); }},
+    {Protocol::RDTHROTTLE,  [](){ return (float)Radio::get(RADIO_THROTTLE); }},
+    {Protocol::RDPITCH,     [](){ return (float)Radio::get(RADIO_PITCH); }},
+    {Protocol::RDROLL,      [](){ return (float)Radio::get(RADIO_ROLL); }},
+    {Protocol::RDYAW,       [](){ return (float)Radio::get(RADIO_YAW); }},
+    {Protocol::RDGEAR,      [](){ return (float)Radio::get(RADIO_GEAR); }},
+    // ESC arming progress from 0 to 1, which is reached once they are armed
+    {Protocol::ARMING,      [](){ return output.armingProgress(); }},
+};
+// slowly changing diagnostics, sent at a lower rate to leave the link free
+const telemLine diagnosticTable[] = {
+    // control loop timing, for finding how short "Output Period" can be
+    {Protocol::LOOPMEAN,    [](){ return (float)ServoGenerator::frameStats().mean; }},
+    {Protocol::LOOPMAX,     [](){ return (float)ServoGenerator::frameStats().longest; }},
+    {Protocol::LOOPHEADROOM,[](){ return (float)ServoGenerator::frameStats().headroom(); }},
+    {Protocol::LOOPSKIPPED, [](){ return (float)ServoGenerator::frameStats().skipped; }},
+    {Protocol::LOOPPERIOD,  [](){ return (float)ServoGenerator::frameStats().period; }},
+    // milliseconds from power up until arming was possible
+    {Protocol::READYTIME,   [](){ return (float)readyTime; }},
+    // percent of the processor in use, and the part of that in interrupts
+    {Protocol::CPULOAD,     [](){ return CpuLoad::load(); }},
+    {Protocol::ISRLOAD,     [](){ return CpuLoad::isrLoad(); }},
+    // bytes the stack has never reached, and the most the heap has used;
+    // the lowest headroom of this build is kept in storage record 41
+    {Protocol::STACKFREE,   [](){ return (float)MemoryMonitor::stackHeadroom(); }},
+    {Protocol::HEAPSIZE,    [](){ return (float)MemoryMonitor::heapSize(); }},
 };
 
+// Each telemetry message is 11 bytes and the link carries about 960 bytes
+// per second at Protocol::BAUD_RATE. These rates use about 800 of them,
+// leaving room for state strings and profile reports; sending faster than
+// the link drains fills the serial buffer and stalls the loop.
 const uint8_t telemetryTotal =
     sizeof(telemetryTable)/sizeof(telemetryTable[0]);
-const uint16_t refreshInterval = 240;
-const uint16_t transmitInterval = refreshInterval / telemetryTotal;
-void sendTelemetry(){
-    static auto timer = Interval::every(transmitInterval);
-    static int nextTelemIndex = 0;
-    if(timer()){
-        comms.sendTelem(nextTelemIndex, telemetryTable[nextTelemIndex]());
-        nextTelemIndex = (nextTelemIndex+1) % telemetryTotal;
+const uint16_t transmitInterval = 16;
+const uint8_t diagnosticTotal =
+    sizeof(diagnosticTable)/sizeof(diagnosticTable[0]);
+const uint16_t diagnosticInterval = 100;
+// lines of the profile report: the profile slots, the bus schedule's tasks
+// and its whole frame, then the main loop's tasks
+uint8_t reportLength(){
+    return NUM_PROFILES + busScheduler.size() + 1 + scheduler.size();
+}
+uint8_t reportLine(uint8_t i, char* buf, uint8_t len){
+    if(i < NUM_PROFILES) return profileLine(i, buf, len);
+    i -= NUM_PROFILES;
+    if(i <= busScheduler.size()) return busScheduler.statsLine(i, buf, len);
+    i -= busScheduler.size() + 1;
+    return scheduler.statsLine(i, buf, len);
+}
+// index of the next report line to send, or REPORT_DONE when done
+const uint8_t REPORT_DONE = 0xff;
+uint8_t nextReportLine = REPORT_DONE;
+// sends the lines of a table one per call, starting over at the end
+struct telemCycle{
+    const telemLine* table;
+    uint8_t total;
+    uint8_t next;
+    void send(){
+        const telemLine& line = table[next];
+        comms.sendTelem(line.id, line.get());
+        next = (next+1) % total;
     }
+};
+telemCycle telemetry   = {telemetryTable,  telemetryTotal,  0};
+telemCycle diagnostics = {diagnosticTable, diagnosticTotal, 0};
+
+// sends one report line per run after a PROFILE_REPORT command,
+// spreading the report out so the serial port can drain between lines
+void sendProfile(){
+    while(nextReportLine < reportLength()){
+        char line[160];
+        uint8_t length = reportLine(nextReportLine++, line, sizeof(line));
+        if(length != 0){
+            comms.sendString(line);
+            return;
+        }
+    }
+    nextReportLine = REPORT_DONE;
 }
 
+void setupSchedule(){
+    // the flight controls take precedence when both are due
+    scheduler.add(control, CONTROL_PERIOD, 0);
+    scheduler.add([](){ telemetry.send(); }, transmitInterval, 1);
+    scheduler.add([](){ diagnostics.send(); }, diagnosticInterval, 2);
+    scheduler.add(sendProfile, 200, 2);
+    // drains the trace when it is enabled by a TRACE_ENABLE command
+    scheduler.add([](){ comms.sendTrace(); }, CONTROL_PERIOD, 3);
+    scheduler.begin();
+    comms.setProfileCallback([](){ nextReportLine = 0; });
+}
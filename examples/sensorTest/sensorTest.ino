@@ -1,4 +1,3 @@
-#include "Wire.h"
 #include "SPI.h"
 #include "MINDS-i-Drone.h"
 
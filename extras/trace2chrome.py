@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Convert a capture of a drone's comm link into Chrome trace JSON.
+
+Tracing is started with the TRACE_ENABLE command (Protocol::commandType 6,
+second byte 2 for one shot snapshots, or 1 for continuous tracing, which at
+9600 baud drops most records). The drone then sends its Trace records in
+STRING messages of subtype TRACE. Save everything the drone sends to a file, for example with
+    stty -F /dev/ttyUSB0 9600 raw && cat /dev/ttyUSB0 > capture.bin
+then convert it with
+    python3 trace2chrome.py capture.bin -o trace.json
+and open the result in chrome://tracing or https://ui.perfetto.dev
+
+Timestamps are 16 bit counts of 4us ticks, so they wrap every 262ms; they are
+unwrapped assuming no gap between records is longer than that. The servo
+generator's frame records keep the gaps short while the outputs are running.
+Where records were dropped, as between one shot snapshots, the time that
+passed is unknown; the timeline starts again after a fixed gap, marked with
+the number of records lost.
+"""
+
+import argparse
+import json
+import sys
+
+HEADER = b"\x13\x37"
+FOOTER = 0x9A
+# STRING message type (3) with the TRACE subtype (2)
+TRACE_LABEL = (2 << 4) | 3
+MAX_MESSAGE = 64
+
+INSTANT, BEGIN, END = 0x00, 0x40, 0x80
+PHASE_MASK = 0xC0
+# Trace::DROPPED, recorded after records were lost; its data is how many
+DROPPED = 0
+# microseconds left on the timeline where records were dropped
+DROP_GAP_US = 1000.0
+
+# Trace::Event ids; the name and the timeline lane each is drawn in
+EVENTS = {
+    1: ("servo frame", "interrupts"),
+    2: ("frame callback", "interrupts"),
+    3: ("bus task", "interrupts"),
+    4: ("loop task", "main loop"),
+    5: ("comm message", "main loop"),
+    6: ("eeprom write", "interrupts"),
+    7: ("radio frame", "interrupts"),
+}
+LANES = {"main loop": 0, "interrupts": 1, "user": 2}
+
+
+def fletcher16_resume(data, last):
+    """Protocol::fletcher16_resume, with its partial reductions"""
+    a, b = last & 0xFF, (last >> 8) & 0xFF
+    i = 0
+    while i < len(data):
+        for byte in data[i:i + 20]:
+            a += byte
+            b += a
+        i += 20
+        a = (a & 0xFF) + (a >> 8)
+        b = (b & 0xFF) + (b >> 8)
+    a = (a & 0xFF) + (a >> 8)
+    b = (b & 0xFF) + (b >> 8)
+    return ((b << 8) | a) & 0xFFFF
+
+
+def string_checksum(label, body):
+    """Checksum of a message sent by Protocol::sendStringMessage"""
+    return fletcher16_resume(body, fletcher16_resume(bytes([label]), 0xFFFF))
+
+
+def trace_messages(capture):
+    """Yield the body of each valid TRACE message in the capture"""
+    start = capture.find(HEADER)
+    while start != -1:
+        label_at = start + len(HEADER)
+        if label_at < len(capture) and capture[label_at] == TRACE_LABEL:
+            # the body may contain footer bytes; the checksum finds the end
+            end = label_at + 1
+            limit = min(len(capture), label_at + MAX_MESSAGE)
+            while end < limit:
+                if capture[end] == FOOTER and end - label_at >= 3:
+                    body = capture[label_at + 1:end - 2]
+                    found = (capture[end - 2] << 8) | capture[end - 1]
+                    if found == string_checksum(TRACE_LABEL, body):
+                        yield body
+                        break
+                end += 1
+        start = capture.find(HEADER, start + 1)
+
+
+def records(capture):
+    """Yield (id, data, raw time) for every record"""
+    for body in trace_messages(capture):
+        if len(body) % 4 != 0:
+            continue
+        for i in range(0, len(body), 4):
+            yield body[i], body[i + 1], (body[i + 2] << 8) | body[i + 3]
+
+
+def convert(capture, tick_us):
+    events = []
+    now = None
+    last_raw = 0
+    for ident, data, raw in records(capture):
+        if now is None:
+            now = 0.0
+        elif ident == DROPPED:
+            # the time since the last record is unknown, so the timeline
+            # starts again from this one
+            now += DROP_GAP_US
+        else:
+            now += ((raw - last_raw) & 0xFFFF) * tick_us
+        last_raw = raw
+
+        if ident == DROPPED:
+            events.append({"name": "dropped %d records" % data,
+                           "ph": "i", "s": "g", "ts": now,
+                           "pid": 0, "tid": 0})
+            continue
+
+        event = ident & ~PHASE_MASK
+        name, lane = EVENTS.get(event, ("user %d" % event, "user"))
+        phase = {INSTANT: "i", BEGIN: "B", END: "E"}.get(ident & PHASE_MASK)
+        if phase is None:
+            continue
+        entry = {"name": name, "ph": phase, "ts": now,
+                 "pid": 0, "tid": LANES[lane], "args": {"data": data}}
+        if phase == "i":
+            entry["s"] = "t"
+        events.append(entry)
+
+    for lane, tid in LANES.items():
+        events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                       "tid": tid, "args": {"name": lane}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="raw bytes received from the drone")
+    parser.add_argument("-o", "--output", help="JSON file; default stdout")
+    parser.add_argument("--tick", type=float, default=4.0,
+                        help="microseconds per timestamp tick (default 4, "
+                             "for a 16MHz board)")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        trace = convert(f.read(), args.tick)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
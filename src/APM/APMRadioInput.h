@@ -3,59 +3,235 @@
 
 #include "Arduino.h"
 #include "util/atomic.h"
+#include "APM/ServoGenerator.h"
+#include "util/CpuLoad.h"
+#include "util/Trace.h"
 #if defined(__AVR_ATmega2560__)
 
+/**
+ * PPM radio decoder for the APM 2.*
+ * The time between rising edges is measured with TIMER5's input capture at
+ *     1/16us resolution. A gap longer than SYNC_PULSE_LENGTH ends a frame.
+ *     The timer wraps every 4.096ms, shorter than most sync gaps, so gaps are
+ *     also timed with micros() to catch the ones that wrap.
+ * Intervals outside [MIN_VALID, MAX_VALID] are glitches; a frame containing
+ *     one is dropped whole instead of letting a bad reading through. The
+ *     channel count is found from the frames themselves, and a frame with a
+ *     different count is only believed once it repeats.
+ * The capture interrupt comes through ServoGenerator, which owns the timer 5
+ *     vectors, unless the build defines SERVOGEN_NO_TIMER5.
+ * Good frames are double buffered, so a frame is only seen once all of its
+ *     channels have arrived. Each one carries a sequence number and the time
+ *     it completed, so signal loss shows up as the frame age growing.
+ */
 namespace APMRadio {
 	static const uint16_t SYNC_PULSE_LENGTH = 42000;
+	//microseconds between edges past which the capture interval may have
+	//wrapped; between the longest valid pulse and the 4096us wrap
+	static const uint16_t LONG_GAP = 3500;
 	static const uint16_t SCALE    = 100;
 	static const uint16_t MINPULSE = 14900;
 	static const uint16_t MAXPULSE = MINPULSE + 180*SCALE;
 	static const uint16_t DEFAULTP = MINPULSE +  90*SCALE;
+	//APM2.* has 8 input channels
+	static const uint8_t  MAX_CHANNELS = 8;
+	//fewest channels a frame can have
+	static const uint8_t  MIN_CHANNELS = 4;
+	//shortest and longest believable channel intervals in timer ticks
+	static const uint16_t MIN_VALID = 11200; //700us
+	static const uint16_t MAX_VALID = 36800; //2300us
+	//frames in a row needed to accept a new channel count
+	static const uint8_t  COUNT_CONFIRM = 3;
+	//milliseconds without a good frame before the signal is considered lost
+	static const uint16_t FAILSAFE_TIME = 100;
 
-	volatile uint16_t pulse[8]; //APM2.* has 8 input channels
+	class Frame{
+	public:
+		uint16_t pulse[MAX_CHANNELS];
+		uint8_t  channels;
+		//incremented for every good frame; 0 if none has arrived yet
+		uint16_t sequence;
+		//micros() when the frame completed
+		uint32_t time;
+	};
+
+	//frames[front] is the newest good frame; the other is being received
+	Frame frames[2];
+	volatile uint8_t front = 0;
+	volatile uint8_t detectedChannels = 0;
+	volatile uint16_t droppedFrames = 0;
+	//smoothed microseconds between good frames
+	volatile uint32_t meanFrameInterval = 0;
+	//longest delay in timer ticks between an edge and its capture interrupt
+	volatile uint16_t maxLateTicks = 0;
+
+	void isrCapture();
 
 	/**
 	 * Start tracking the radio inputs on an APM 2.* board
 	 * This makes use of TIMER5's input capture capability
 	 */
 	void setup(){
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+			for(int f=0; f<2; f++){
+				for(int i=0; i<MAX_CHANNELS; i++) frames[f].pulse[i] = DEFAULTP;
+				frames[f].channels = 0;
+				frames[f].sequence = 0;
+				frames[f].time     = 0;
+			}
+		}
+	#if !defined(SERVOGEN_NO_TIMER5)
+		ServoGenerator::setCaptureHandler(ServoGenerator::TIMER_5, isrCapture);
+	#endif
 		pinMode(48, INPUT);   //timer5 is pin 48
 		TCCR5A = 0;
 		TCCR5B = 0;
 		TCCR5B |= _BV(ICES5); //rising edge trigger
 		TIMSK5 |= _BV(ICIE5); //enable enternal interrupt capture
 	    TCCR5B |= _BV(CS50);  //set clock at 1x prescaler
-	    for(int i=0; i<8; i++) pulse[i] = DEFAULTP;
+	}
+
+	/** Get a copy of the newest complete frame */
+	Frame frame(){
+		Frame f;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ f = frames[front]; }
+		return f;
 	}
 
 	/** Get the raw radio signal on channel at its highest resolution */
 	uint16_t inline raw(uint8_t num){
 		uint16_t data;
-		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ data = pulse[num]; }
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ data = frames[front].pulse[num]; }
 		return data;
 	}
 
+	/** Number of channels in the radio's frames; 0 until one is received */
+	uint8_t channels(){ return detectedChannels; }
+
+	/** Milliseconds since the newest complete frame arrived */
+	uint32_t frameAge(){
+		uint32_t time;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ time = frames[front].time; }
+		return (micros() - time)/1000;
+	}
+
+	/** True if no good frame has arrived within FAILSAFE_TIME */
+	bool signalLost(){
+		return frameAge() > FAILSAFE_TIME;
+	}
+
+	/** Good frames received per second, averaged over the last few */
+	float frameRate(){
+		uint32_t interval;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ interval = meanFrameInterval; }
+		if(interval == 0) return 0;
+		return 1000000.0f/interval;
+	}
+
+	/** Number of frames thrown out for bad pulse widths or channel counts */
+	uint16_t lostFrames(){
+		uint16_t count;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ count = droppedFrames; }
+		return count;
+	}
+
+	/**
+	 * The longest delay seen between a radio edge and the interrupt that
+	 *     reads it; this is how long other code kept interrupts disabled.
+	 *     Delays longer than a pulse corrupt the radio readings.
+	 * @param  reset Clear the recorded maximum after reading it
+	 * @return       The delay in microseconds
+	 */
+	uint16_t maxLatency(bool reset = false){
+		uint16_t ticks;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+			ticks = maxLateTicks;
+			if(reset) maxLateTicks = 0;
+		}
+		return ticks/(F_CPU/1000000L);
+	}
+
 	/** Get the radio signal on channel `num` mapped between 0 and 180 */
 	uint8_t inline get(uint8_t num){
 		uint16_t val = constrain(raw(num), MINPULSE, MAXPULSE);
 		return (val-MINPULSE)/SCALE;
 	}
-}
 
-ISR(TIMER5_CAPT_vect){
-	static uint8_t cNum; //channel Number
-	static uint16_t previousTriggerTime;
+	/**
+	 * Called from the capture interrupt when a sync gap ends a frame of
+	 * `count` channels; publishes the frame being received if it is good
+	 */
+	void endFrame(uint8_t count, bool glitched){
+		static uint8_t candidate, candidateRuns;
 
-	uint16_t dt = ICR5 - previousTriggerTime;
-	previousTriggerTime = ICR5;
+		if(glitched || count < MIN_CHANNELS){
+			droppedFrames++;
+			return;
+		}
+		if(count != detectedChannels){
+			// a new channel count has to repeat before it is believed
+			if(count == candidate){
+				if(++candidateRuns >= COUNT_CONFIRM) detectedChannels = count;
+			} else {
+				candidate     = count;
+				candidateRuns = 1;
+			}
+			if(count != detectedChannels){
+				droppedFrames++;
+				return;
+			}
+		}
 
-	if (dt > APMRadio::SYNC_PULSE_LENGTH) { //sync pulse detected
-		cNum = 0;
-	} else {
-		APMRadio::pulse[cNum] = dt;
-		cNum = (cNum+1) % 8;
+		const Frame& last = frames[front];
+		Frame& next = frames[front^1];
+		uint32_t now = micros();
+		if(last.sequence != 0){
+			int32_t dt = now - last.time;
+			if(meanFrameInterval == 0) meanFrameInterval = dt;
+			else meanFrameInterval += (dt - (int32_t)meanFrameInterval)/8;
+		}
+		next.channels = count;
+		next.sequence = (last.sequence == 0xffff)? 1 : last.sequence+1;
+		next.time     = now;
+		front ^= 1;
+		Trace::mark(Trace::RADIO_FRAME, count);
+	}
+
+	/** TIMER5 input capture handler; measures the interval ending at ICR5 */
+	void isrCapture(){
+		static uint8_t cNum; //channel Number
+		static bool glitched = true;
+		static uint16_t previousTriggerTime;
+		static uint32_t previousMicros;
+
+		uint16_t late = TCNT5 - ICR5;
+		if(late > maxLateTicks) maxLateTicks = late;
+		CpuLoad::IsrTimer timer(CpuLoad::RADIO_ISR);
+
+		uint16_t dt = ICR5 - previousTriggerTime;
+		previousTriggerTime = ICR5;
+		// micros() at the edge, taking out the interrupt's latency
+		uint32_t edge = micros() - late/(F_CPU/1000000L);
+		bool longGap = (edge - previousMicros > LONG_GAP);
+		previousMicros = edge;
+
+		if (longGap || dt > SYNC_PULSE_LENGTH) { //sync pulse detected
+			endFrame(cNum, glitched);
+			cNum = 0;
+			glitched = false;
+		} else if (dt < MIN_VALID || dt > MAX_VALID || cNum >= MAX_CHANNELS) {
+			glitched = true;
+		} else {
+			frames[front^1].pulse[cNum++] = dt;
+		}
 	}
 }
 
+#if defined(SERVOGEN_NO_TIMER5)
+ISR(TIMER5_CAPT_vect){
+	APMRadio::isrCapture();
+}
+#endif
+
 #endif
 #endif
@@ -0,0 +1,61 @@
+#include "OneShot.h"
+
+using namespace OneShot;
+
+namespace {
+    constexpr uint16_t TICKS_PER_US = F_CPU / 1000000L;
+
+    ServoGenerator::Generator generator(TIMER);
+
+    // shortest pulse in timer ticks; the longest is twice as long
+    uint16_t minTicks = 125 * TICKS_PER_US;
+    bool begun = false;
+}
+
+namespace OneShot{
+    void begin(Mode mode){
+        begun = true;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            minTicks = ((mode == ONESHOT42)? 42 : 125) * TICKS_PER_US;
+            generator.beginTriggered();
+            ServoGenerator::setTriggerCallback(fire);
+        }
+    }
+
+    void set(uint8_t channel, float fraction){
+        fraction = constrain(fraction, 0.0f, 1.0f);
+        generator.setTicks(channel, minTicks + (uint16_t)(fraction*minTicks));
+    }
+
+    void disable(uint8_t channel){
+        generator.disable(channel);
+    }
+
+    bool enable(uint8_t channel, int pin){
+        if(!begun) begin();
+        digitalWrite(pin, LOW);
+        bool pass = generator.enable(channel, pin);
+        if(pass) generator.setTicks(channel, minTicks);
+        return pass;
+    }
+
+    void fire(){
+        generator.trigger();
+    }
+
+    bool Channel::attach(uint8_t arduinopin){
+        if(channel != -1) return false;
+        int8_t ch = generator.freeChannel();
+        if(ch != -1){
+            enable(ch, arduinopin);
+            channel = ch;
+            return true;
+        }
+        return false;
+    }
+
+    void Channel::detach(){
+        if(channel != -1) disable(channel);
+        channel = -1;
+    }
+}
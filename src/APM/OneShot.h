@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "APM/ServoGenerator.h"
+
+/**
+ * OneShot ESC signal generator
+ * Short pulses (125-250us for OneShot125, 42-84us for OneShot42) are timed by
+ *     a triggered ServoGenerator::Generator on a second 16 bit timer at the
+ *     full clock rate, giving 1/16us resolution
+ * A pulse is started on every enabled channel once each ServoGenerator frame,
+ *     right after the frame's update callback returns, so motor commands go
+ *     out as soon as they are computed instead of at the start of the next
+ *     frame
+ * The primary ServoGenerator must be running to provide the frame timing
+ */
+namespace OneShot{
+    /**
+     * Timer used to time the pulses
+     * This must be a 16-bit timer other than the primary ServoGenerator's;
+     *     on the APM2 timer 5 is used by the radio input
+     * Taking the timer over disables analogWrite on its PWM pins
+     */
+    constexpr ServoGenerator::Timer TIMER = ServoGenerator::TIMER_3;
+    /** The maximum number of OneShot channels */
+    constexpr uint8_t MAX_OUTPUTS = ServoGenerator::MAX_OUTPUTS;
+
+    enum Mode { ONESHOT125, ONESHOT42 };
+
+    /**
+     * Start timing pulses in `mode` and trigger them from ServoGenerator
+     * Called automatically with ONESHOT125 when the first channel is enabled
+     */
+    void begin(Mode mode = ONESHOT125);
+    /**
+     * Set a previously enabled channel's pulse
+     * @param channel  Channel index [0,MAX_OUTPUTS)
+     * @param fraction [0,1] from the shortest to the longest pulse
+     */
+    void set(uint8_t channel, float fraction);
+    /**
+     * Turn off a previously enabled channel
+     * @param channel Channel index [0,MAX_OUTPUTS)
+     */
+    void disable(uint8_t channel);
+    /**
+     * Enable an unused channel and attach it to an arduino pin
+     * Sets `pin` to output; the channel sends the shortest pulse until set
+     * @param  channel Channel index [0,MAX_OUTPUTS)
+     * @param  pin     Arduino digital or analog pin
+     * @return         true if channel was newly attached
+     */
+    bool enable(uint8_t channel, int pin);
+    /**
+     * Start a pulse on every enabled channel now
+     * Normally called by ServoGenerator each frame; interrupts must be off
+     */
+    void fire();
+
+    class Channel{
+        int8_t channel;
+    public:
+        Channel(): channel(-1) {}
+        /**
+         * Start generating pulses on a given pin
+         * @param  arduinopin The arduino pin to attach to
+         * @return            If the channel was successfully attached
+         */
+        bool attach(uint8_t arduinopin);
+        /** disables pulse generation on the pin */
+        void detach();
+        /** @return True if attached and generating pulses */
+        bool attached(){ return channel != -1; }
+        /**
+         * Write a pulse width
+         * @param fraction [0,1] from the shortest to the longest pulse
+         */
+        void write(float fraction){
+            if(channel != -1) set(channel, fraction);
+        }
+    };
+}
@@ -1,148 +1,487 @@
 #include "ServoGenerator.h"
-
-#define EXPCAT(A,B,C) EXPANDEDCONCATENATE(A,B,C)
-#define EXPANDEDCONCATENATE(A,B,C) A ## B ## C
-#define TIMER_ISR(N,V) TIMER_ISR_EXP(N,V)
-#define TIMER_ISR_EXP(N,V) TIMER ## N ## _ ## V ## _vect
+#include "util/CpuLoad.h"
+#include "util/Trace.h"
 
 using namespace ServoGenerator;
 
 namespace {
-    volatile uint8_t& TCCRA = EXPCAT(TCCR, TIMER_NUM,A);
-    volatile uint8_t& TCCRB = EXPCAT(TCCR, TIMER_NUM,B);
-    volatile uint8_t& TCCRC = EXPCAT(TCCR, TIMER_NUM,C);
-    volatile uint8_t& TIFR  = EXPCAT(TIFR, TIMER_NUM, );
-    volatile uint8_t& TIMSK = EXPCAT(TIMSK,TIMER_NUM, );
-    volatile uint16_t& ICR  = EXPCAT(ICR,  TIMER_NUM, );
-    volatile uint16_t& TCNT = EXPCAT(TCNT, TIMER_NUM, );
-    volatile uint16_t& OCRA = EXPCAT(OCR,  TIMER_NUM,A);
-    volatile uint16_t& OCRB = EXPCAT(OCR,  TIMER_NUM,B);
-
-    class Output{
-    public:
-        Output(): highTime(0xffff), pinMask(0), pinReg(0) {}
-        uint16_t highTime;
-        uint8_t pinMask;
-        volatile uint8_t* pinReg;
-        void disable() volatile {
-            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                pinMask = 0;
-                pinReg = 0;
-                highTime = 0xffff;
-            }
+    constexpr uint16_t OFF = 0xffff;
+
+    constexpr uint8_t PRESCALAR = 8;
+    //works for prescalars less than or equal to 16
+    constexpr uint8_t SERVO_TICKS_PER_US = (F_CPU / (PRESCALAR * 1e6L));
+    // ticks per microsecond in triggered mode, which runs unscaled
+    constexpr uint8_t FAST_TICKS_PER_US = (F_CPU / 1000000L);
+
+    // longest pulse allowed to start at the deadline, plus margin
+    constexpr uint16_t DEADLINE_MARGIN = 2600;
+
+    // generator running on each timer, for the interrupts to find
+    Generator* volatile instances[NUM_TIMERS];
+    // capture interrupt handlers for timers without a generator
+    volatile CaptureFunc captureHandlers[NUM_TIMERS];
+
+    Generator primaryGenerator(TIMER_1);
+}
+
+#define TIMER_REGISTERS(N) { &TCCR##N##A, &TCCR##N##B, &TIFR##N, &TIMSK##N, \
+                             &ICR##N, &TCNT##N, &OCR##N##A, &OCR##N##B }
+
+// register bit positions are the same on every 16-bit timer, so the timer 1
+// names are used throughout
+Generator::Registers
+Generator::registersFor(Timer timer){
+    switch(timer){
+    #if defined(TCNT5)
+        case TIMER_3: return TIMER_REGISTERS(3);
+        case TIMER_4: return TIMER_REGISTERS(4);
+        case TIMER_5: return TIMER_REGISTERS(5);
+    #endif
+        default:      return TIMER_REGISTERS(1);
+    }
+}
+
+void
+Generator::Output::disable() volatile {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        pinMask = 0;
+        pinReg = 0;
+        highTime = OFF;
+    }
+}
+
+void
+Generator::Output::setPin(int p) volatile {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        pinMask = digitalPinToBitMask(p);
+        pinReg = portOutputRegister(digitalPinToPort(p));
+    }
+}
+
+void
+Generator::ActionTable::rebuildPorts(const volatile Output* output){
+    numPorts = 0;
+    for(uint8_t i=0; i<MAX_OUTPUTS && actions[i].time != OFF; i++){
+        const volatile Output& o = output[actions[i].channel];
+        if(!o.enabled()) continue;
+        uint8_t p = 0;
+        while(p < numPorts && ports[p].reg != o.pinReg) p++;
+        if(p == numPorts){
+            ports[p].reg  = o.pinReg;
+            ports[p].mask = 0;
+            numPorts++;
         }
-        void setPin(int p) volatile {
-            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-                pinMask = digitalPinToBitMask(p);
-                pinReg = portOutputRegister(digitalPinToPort(p));
-            }
+        ports[p].mask |= o.pinMask;
+    }
+}
+
+// move `channel` to its sorted position for a new falling edge `time`
+void
+Generator::ActionTable::update(const volatile Output* output,
+                               uint8_t channel, uint16_t time){
+    uint8_t i = 0;
+    while(actions[i].channel != channel) i++;
+    uint16_t old = actions[i].time;
+    if(time > old){
+        while(i+1 < MAX_OUTPUTS && actions[i+1].time < time){
+            actions[i] = actions[i+1];
+            i++;
         }
-        bool enabled() const volatile { return pinMask != 0; }
-        void setHigh() const volatile { *pinReg |= pinMask; }
-        void setLow() const volatile { *pinReg &= ~pinMask; }
-    };
-
-    volatile Output output[MAX_OUTPUTS];
-    volatile uint8_t activeOutputs = 0;
-
-    class Action{ //lawsuit
-    public:
-        uint16_t time;
-        uint8_t channel;
-    };
-    Action actions[MAX_OUTPUTS+1];
-    Action * next = actions;
-    // constructor attribute makes this get run once before main
-    void setupActions() __attribute__ ((constructor));
-    void setupActions() {
-        actions[MAX_OUTPUTS] = {0xffff, 0};
+    } else {
+        while(i > 0 && actions[i-1].time > time){
+            actions[i] = actions[i-1];
+            i--;
+        }
+    }
+    actions[i] = {time, channel};
+    // a channel turning on or off changes which pins rise
+    if((old == OFF) != (time == OFF)) rebuildPorts(output);
+}
+
+Generator::Generator(Timer timer)
+    : reg(registersFor(timer)), activeOutputs(0), front(0), dirty(false),
+      stale(false), frameBase(0), maxLateTicks(0), frameCallback(NULL),
+      inFrameCallback(false), triggerCallback(NULL), frameMode(LEADING_EDGE),
+      requestedDeadline(0), deadlineTicks(0), raised(false), pendingInterval(0),
+      frameNumber(0),
+      begun(false), triggered(false), ticksPerUs(SERVO_TICKS_PER_US) {
+    clearStats();
+    for(uint8_t t=0; t<2; t++){
+        tables[t].actions[MAX_OUTPUTS] = {OFF, 0};
         for(uint8_t i=0; i<MAX_OUTPUTS; i++){
-            actions[i] = {0xffff, i};
+            tables[t].actions[i] = {OFF, i};
         }
+        tables[t].numPorts = 0;
     }
+    next = tables[0].actions;
+    instances[timer] = this;
+}
 
-    // function pointer and state guard for frame update callbacks
-    volatile UpdateFunc frameCallback;
-    volatile bool IN_FRAME_CALLBACK;
+// apply one channel's new highTime to the back table
+// `moved` should be set if the channel's pin changed
+void
+Generator::editTable(uint8_t channel, uint16_t time, bool moved){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        ActionTable& back = tables[front^1];
+        if(stale){
+            back  = tables[front];
+            stale = false;
+        }
+        back.update(output, channel, time);
+        if(moved) back.rebuildPorts(output);
+        dirty = true;
+    }
+}
 
-    constexpr uint8_t PRESCALAR = 8;
-    //works for prescalars less than or equal to 16
-    constexpr uint8_t TICKS_PER_MS = (F_CPU / (PRESCALAR * 1e6L));
+void
+Generator::updateDeadline(){
+    const uint16_t margin = DEADLINE_MARGIN * ticksPerUs;
+    if(requestedDeadline != 0){
+        deadlineTicks = requestedDeadline * ticksPerUs;
+    } else if(*reg.icr > margin){
+        deadlineTicks = *reg.icr - margin;
+    } else {
+        deadlineTicks = 0;
+    }
+}
 
-    uint16_t constexpr intervalFromMicros(uint16_t us){
-        return us * TICKS_PER_MS;
+// bring in the latest edits unless this frame's pulses are under way
+inline void
+Generator::swapTables(){
+    if(!dirty) return;
+    front ^= 1;
+    dirty = false;
+    stale = true;
+}
+
+// start the pulses in the front table; interrupts must be off
+inline void
+Generator::raiseOutputs(){
+    const ActionTable& table = tables[front];
+    for(uint8_t p=0; p<table.numPorts; p++){
+        *table.ports[p].reg |= table.ports[p].mask;
     }
+    frameBase = *reg.tcnt;
 
-    uint16_t constexpr microsFromInterval(uint16_t ticks){
-        return ticks / TICKS_PER_MS;
+    next = const_cast<Action*>(table.actions);
+    raised = true;
+    if(next->time == OFF) return;
+    *reg.ocra  = frameBase + next->time;
+    *reg.tifr  = _BV(OCF1A);
+    *reg.timsk |= _BV(OCIE1A);
+}
+
+inline void
+Generator::runFrameCallback(){
+    inFrameCallback = true;
+    const uint8_t  startFrame = frameNumber;
+    const uint16_t start = *reg.tcnt;
+    Trace::begin(Trace::FRAME_CALLBACK);
+    NONATOMIC_BLOCK(NONATOMIC_FORCEOFF){
+        frameCallback(*reg.icr / ticksPerUs);
+    }
+    Trace::end(Trace::FRAME_CALLBACK);
+    inFrameCallback = false;
+
+    // the count restarted once for every frame start the callback overran,
+    // including one that is still pending
+    const uint16_t end = *reg.tcnt;
+    uint8_t wraps = frameNumber - startFrame;
+    if(wraps == 0 && end < start) wraps = 1;
+    uint32_t ticks = (uint32_t)wraps * (*reg.icr) + end - start;
+    uint16_t t = (ticks > 0xffff)? 0xffff : ticks;
+    if(t < shortestTicks) shortestTicks = t;
+    if(t > longestTicks)  longestTicks  = t;
+    totalTicks += t;
+    timedFrames++;
+    // keep the running mean from overflowing
+    if(timedFrames == 0xffff){
+        totalTicks  /= 2;
+        timedFrames /= 2;
     }
 }
 
-namespace ServoGenerator{
-    bool begun;
+void
+Generator::clearStats(){
+    skippedFrames = 0;
+    shortestTicks = 0xffff;
+    longestTicks  = 0;
+    totalTicks    = 0;
+    timedFrames   = 0;
+}
 
-    void set(uint8_t channel, uint16_t us){
-        output[channel].highTime = intervalFromMicros(us);
+void
+Generator::begin(uint16_t refreshIntervalMicroseconds){
+    begun = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        triggered  = false;
+        ticksPerUs = SERVO_TICKS_PER_US;
+
+        // CTC (WGM 12), clear when TCNT == ICR, prescalar = 8
+        *reg.tccra = 0;
+        *reg.tccrb = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+
+        // enable the ICF (TCNT==ICR) interrupt; the OCRA (TCNT==OCRA)
+        // interrupt is enabled while each frame's pulses are running
+        *reg.timsk |= _BV(ICIE1);
+
+        *reg.icr  = refreshIntervalMicroseconds * ticksPerUs;
+        *reg.ocra = OFF;
+        pendingInterval = 0;
+
+        // clear the timer count and pending interrupts
+        *reg.tcnt  = 0;
+        *reg.tifr  = _BV(OCF1A) | _BV(ICF1);
+
+        updateDeadline();
+        clearStats();
     }
+}
 
-    void disable(uint8_t channel){
-        if(output[channel].enabled()){
-            output[channel].disable();
-            activeOutputs--;
-        }
+void
+Generator::beginTriggered(){
+    begun = true;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        triggered  = true;
+        ticksPerUs = FAST_TICKS_PER_US;
+
+        // normal mode, prescalar = 1
+        *reg.tccra = 0;
+        *reg.tccrb = _BV(CS10);
+        *reg.timsk = 0;
+        *reg.tifr  = _BV(OCF1A) | _BV(OCF1B) | _BV(ICF1);
     }
+}
 
-    bool enable(uint8_t channel, int pin){
-        bool pass = false;
-        if(!output[channel].enabled()){
-            activeOutputs++;
-            pass = true;
-            if(!begun) begin(DEFAULT_REFRESH_INTERVAL);
+void
+Generator::setInterval(uint16_t refreshIntervalMicroseconds){
+    if(!begun || triggered){
+        begin(refreshIntervalMicroseconds);
+        return;
+    }
+    // ICR is not double buffered in this mode; moving it below a running
+    // count would let the count run on to 0xffff and stretch the frame
+    pendingInterval = refreshIntervalMicroseconds * ticksPerUs;
+}
+
+void
+Generator::set(uint8_t channel, uint16_t us){
+    setTicks(channel, us * ticksPerUs);
+}
+
+void
+Generator::setTicks(uint8_t channel, uint16_t time){
+    if(output[channel].highTime == time) return;
+    output[channel].highTime = time;
+    if(output[channel].enabled()) editTable(channel, time);
+}
+
+void
+Generator::disable(uint8_t channel){
+    if(output[channel].enabled()){
+        output[channel].setLow();
+        output[channel].disable();
+        activeOutputs--;
+        editTable(channel, OFF);
+    }
+}
+
+bool
+Generator::enable(uint8_t channel, int pin){
+    bool pass = false;
+    if(!output[channel].enabled()){
+        activeOutputs++;
+        pass = true;
+        if(!begun) begin(DEFAULT_REFRESH_INTERVAL);
+    }
+    pinMode(pin, OUTPUT);
+    output[channel].setPin(pin);
+    editTable(channel, output[channel].highTime, true);
+    return pass;
+}
+
+int8_t
+Generator::freeChannel(){
+    for(uint8_t ch=0; ch<MAX_OUTPUTS; ch++){
+        if(!output[ch].enabled()) return ch;
+    }
+    return -1;
+}
+
+void
+Generator::setFrameMode(FrameMode mode, uint16_t deadline){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        frameMode = mode;
+        requestedDeadline = deadline;
+        updateDeadline();
+    }
+}
+
+void
+Generator::setUpdateCallback(UpdateFunc callback){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        frameCallback = callback;
+    }
+}
+
+void
+Generator::setTriggerCallback(TriggerFunc trigger){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        triggerCallback = trigger;
+    }
+}
+
+uint16_t
+Generator::maxLatency(bool reset){
+    uint16_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        ticks = maxLateTicks;
+        if(reset) maxLateTicks = 0;
+    }
+    return ticks / ticksPerUs;
+}
+
+FrameStats
+Generator::frameStats(bool reset){
+    FrameStats stats;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        stats.shortest = (timedFrames == 0)? 0 : shortestTicks / ticksPerUs;
+        stats.longest  = longestTicks / ticksPerUs;
+        stats.mean     = (timedFrames == 0)? 0 :
+                            totalTicks / timedFrames / ticksPerUs;
+        stats.period   = triggered? 0 : *reg.icr / ticksPerUs;
+        stats.skipped  = skippedFrames;
+        if(reset) clearStats();
+    }
+    return stats;
+}
+
+void
+Generator::trigger(){
+    if(activeOutputs == 0) return;
+    // a pulse still running from the last trigger is left to finish
+    if(*reg.timsk & _BV(OCIE1A)) return;
+    swapTables();
+    raiseOutputs();
+}
+
+void
+Generator::isrCompareA(){
+    uint16_t late = *reg.tcnt - *reg.ocra;
+    if(late > maxLateTicks && (triggered || late < *reg.icr))
+        maxLateTicks = late;
+
+    do {
+        // a channel disabled mid pulse has already been set low
+        if(output[next->channel].enabled()) output[next->channel].setLow();
+        next++;
+        uint16_t t = next->time;
+        if(t == OFF){
+            // all pulses are done until the next frame
+            *reg.timsk &= ~_BV(OCIE1A);
+            break;
         }
-        pinMode(pin, OUTPUT);
-        output[channel].setPin(pin);
-        return pass;
+        t += frameBase;
+        *reg.ocra = t;
+
+        // compare as a difference; a free running count may wrap mid pulse
+        if((int16_t)(t - *reg.tcnt) > 0) break;
+        //clear any interrupt that may have been generated when OCRA was set
+        else *reg.tifr = _BV(OCF1A);
+    } while(true);
+}
+
+void
+Generator::isrCompareB(){
+    // the update callback missed the deadline; go with the old setpoints
+    *reg.timsk &= ~_BV(OCIE1B);
+    if(!raised) raiseOutputs();
+}
+
+void
+Generator::isrCapture(){
+    swapTables();
+    raised = false;
+    frameNumber++;
+    Trace::mark(Trace::SERVO_FRAME, frameNumber);
+
+    if(pendingInterval != 0){
+        *reg.icr = pendingInterval;
+        pendingInterval = 0;
+        updateDeadline();
     }
 
-    void begin(uint16_t refreshIntervalMicroseconds){
-        begun = true;
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-            // CTC (WGM 12), clear when TCNT == ICR, prescalar = 8
-            TCCRA = 0;
-            TCCRB = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
-
-            // enable the ICF (TCNT==ICR) and OCRA (TCNT==OCRA) interrupt
-            TIMSK |= _BV(ICIE1);
-            TIMSK |= _BV(OCIE1A);
-
-            ICR  = intervalFromMicros(refreshIntervalMicroseconds);
-            OCRA = 0xffff;
-
-            // clear the timer count and pending interrupts
-            TCNT   = 0;
-            TIFR  |= _BV(OCF1A);
-            TIFR  |= _BV(ICF1);
+    if(inFrameCallback == true){
+        // the last callback overran; keep the old setpoints
+        if(skippedFrames != 0xffff) skippedFrames++;
+        raiseOutputs();
+        return;
+    }
+
+    if(frameMode == SAME_FRAME && frameCallback != NULL && deadlineTicks != 0){
+        // compute first, raising the pins from COMPB if it takes too long
+        *reg.ocrb = deadlineTicks;
+        *reg.tifr = _BV(OCF1B);
+        *reg.timsk |= _BV(OCIE1B);
+        runFrameCallback();
+        *reg.timsk &= ~_BV(OCIE1B);
+        if(!raised){
+            swapTables();
+            raiseOutputs();
         }
+    } else {
+        raiseOutputs();
+        if(frameCallback != NULL) runFrameCallback();
     }
+    if(triggerCallback != NULL) triggerCallback();
+}
+
+namespace ServoGenerator{
+    Generator& primary(){ return primaryGenerator; }
 
+    void set(uint8_t channel, uint16_t us){
+        primaryGenerator.set(channel, us);
+    }
+    void disable(uint8_t channel){
+        primaryGenerator.disable(channel);
+    }
+    bool enable(uint8_t channel, int pin){
+        return primaryGenerator.enable(channel, pin);
+    }
+    void begin(uint16_t refreshIntervalMicroseconds){
+        primaryGenerator.begin(refreshIntervalMicroseconds);
+    }
+    void setInterval(uint16_t refreshIntervalMicroseconds){
+        primaryGenerator.setInterval(refreshIntervalMicroseconds);
+    }
     void setUpdateCallback(UpdateFunc callback){
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-            frameCallback = callback;
-        }
+        primaryGenerator.setUpdateCallback(callback);
+    }
+    void setTriggerCallback(TriggerFunc trigger){
+        primaryGenerator.setTriggerCallback(trigger);
+    }
+    void setFrameMode(FrameMode mode, uint16_t deadline){
+        primaryGenerator.setFrameMode(mode, deadline);
+    }
+    uint16_t maxLatency(bool reset){
+        return primaryGenerator.maxLatency(reset);
+    }
+    FrameStats frameStats(bool reset){
+        return primaryGenerator.frameStats(reset);
+    }
+    void setCaptureHandler(Timer timer, CaptureFunc handler){
+        captureHandlers[timer] = handler;
     }
 
 
-    Servo::Servo(): channel(-1) {}
+    Servo::Servo(Generator& gen): generator(&gen), channel(-1) {}
     bool Servo::attach(uint8_t arduinopin){
         if(channel != -1) return false; //already attached
 
         //find open channel, try to attach
-        uint8_t ch = 0;
-        for(; ch<MAX_OUTPUTS; ch++){
-            if(!output[ch].enabled()) break;
-        }
-        if(ch < MAX_OUTPUTS){
-            enable(ch, arduinopin);
+        int8_t ch = generator->freeChannel();
+        if(ch != -1){
+            generator->enable(ch, arduinopin);
             channel = ch;
             return true;
         }
@@ -150,7 +489,7 @@ namespace ServoGenerator{
     }
     void Servo::detach(){
         if(channel != -1)
-            disable(channel);
+            generator->disable(channel);
         channel = -1;
     }
     bool Servo::attached() {
@@ -158,59 +497,36 @@ namespace ServoGenerator{
     }
 }
 
-ISR(TIMER_ISR(TIMER_NUM, COMPA)){
-    do {
-        output[next->channel].setLow();
-        next++;
-        uint16_t t = next->time;
-        OCRA = t;
-
-        if(t > TCNT) break;
-        //clear any interrupt that may have been generated when OCRA was set
-        else TIFR = _BV(OCF1A);
-    } while(true);
-}
-
-ISR(TIMER_ISR(TIMER_NUM, CAPT)){
-    //update each channels highTime; 0xffff if the channel is off
-    for(uint8_t i=0; i<MAX_OUTPUTS; i++){
-        actions[i].time = output[actions[i].channel].highTime;
-    }
-    //run insertion sort on actions[]; optimised with a cycle count benchmark
-    for(uint8_t i=1; i<MAX_OUTPUTS; i++){
-        //load the time and channel of action[i] only when needed
-        uint16_t time = actions[i].time;
-        //quickly check for sorted input
-        if(time >= actions[i-1].time) continue;
-        //swap up the data to make room for actions[i]
-        uint8_t channel = actions[i].channel;
-        uint8_t j = i;
-        while(j>0 && time < actions[j-1].time){
-            // copying all the components individually is slightly faster
-            actions[j].time = actions[j-1].time;
-            actions[j].channel = actions[j-1].channel;
-            j--;
-        }
-        //put the data from actions[i] back into actions[j]
-        actions[j].time = time;
-        actions[j].channel = channel;
-    }
-    //set all signals high
-    //this preserves order because TCNT is monotonically increasing
-    for(uint8_t i=0; i<activeOutputs; i++){
-        output[actions[i].channel].setHigh();
-        actions[i].time += TCNT;
+// The vectors have to be strong: crt1 already makes every vector a weak alias
+// of __bad_interrupt and is linked first, so weak ones here would be dropped
+#define GENERATOR_ISR(N, VECT, HANDLER)                 \
+    ISR(TIMER##N##_##VECT##_vect){                      \
+        CpuLoad::IsrTimer timer(CpuLoad::SERVO_ISR);    \
+        Generator* g = instances[TIMER_##N];            \
+        if(g != NULL) g->HANDLER();                     \
     }
-
-    next = actions;
-    OCRA = next->time;
-
-    if(frameCallback != NULL && IN_FRAME_CALLBACK == false){
-        IN_FRAME_CALLBACK = true;
-        NONATOMIC_BLOCK(NONATOMIC_FORCEOFF){
-            frameCallback(microsFromInterval(ICR));
-        }
-        IN_FRAME_CALLBACK = false;
+// the capture vector is passed on when no generator owns the timer
+#define GENERATOR_CAPTURE_ISR(N)                        \
+    ISR(TIMER##N##_CAPT_vect){                          \
+        Generator* g = instances[TIMER_##N];            \
+        if(g != NULL){                                  \
+            CpuLoad::IsrTimer timer(CpuLoad::SERVO_ISR);\
+            g->isrCapture();                            \
+        } else {                                        \
+            CaptureFunc f = captureHandlers[TIMER_##N];  \
+            if(f != NULL) f();                          \
+        }                                               \
     }
-}
+#define GENERATOR_ISRS(N)                               \
+    GENERATOR_ISR(N, COMPA, isrCompareA)                \
+    GENERATOR_ISR(N, COMPB, isrCompareB)                \
+    GENERATOR_CAPTURE_ISR(N)
 
+GENERATOR_ISRS(1)
+#if defined(TCNT5)
+GENERATOR_ISRS(3)
+GENERATOR_ISRS(4)
+#if !defined(SERVOGEN_NO_TIMER5)
+GENERATOR_ISRS(5)
+#endif
+#endif
@@ -6,14 +6,28 @@
 
 namespace ServoGenerator{
     /**
-     * Timer index that the ServoGenerator will run on
-     * This must be a 16-bit timer
+     * 16-bit timers a Generator can run on
      *     1 on Uno, Leonardo
      *     1,3,4,5 on Mega
+     * Each timer drives at most one Generator. On the APM2 timer 5 is used by
+     *     the radio input and timer 3 by OneShot
+     * Taking a timer over disables analogWrite on its PWM pins
+     * The compare and capture vectors of every timer here are defined by this
+     *     library. Code that uses one of these timers for something else can
+     *     receive its capture interrupt through setCaptureHandler. To define
+     *     the timer 5 vectors yourself instead, build with SERVOGEN_NO_TIMER5
+     *     defined; it has to reach ServoGenerator.cpp, so it belongs in the
+     *     compiler flags rather than the sketch
      */
-    #define TIMER_NUM 1
+    enum Timer : uint8_t {
+        TIMER_1,
+    #if defined(TCNT5)
+        TIMER_3, TIMER_4, TIMER_5,
+    #endif
+        NUM_TIMERS
+    };
     /**
-     * The maximum number of servo output channels that can be produces
+     * The maximum number of servo output channels on one Generator
      * Each additional channel takes up more memory and each used channel
      * costs some processing time each frame.
      */
@@ -29,48 +43,294 @@ namespace ServoGenerator{
      */
     typedef void (*UpdateFunc)(uint16_t microseconds);
     /**
-     * Set a previously enabled channel to a particular signal width
-     * @param channel Channel index [0,MAX_OUTPUTS)
-     * @param us      signal high time in microseconds
+     * Order of the work done at the start of each frame
+     * LEADING_EDGE: pulses rise at the start of the frame with the setpoints
+     *     from the last frame, then the update callback runs
+     * SAME_FRAME: the update callback runs first and the pulses rise as soon
+     *     as it returns, carrying the setpoints it just computed. If it has
+     *     not returned by the deadline, the pulses rise with the old ones
      */
-    void set(uint8_t channel, uint16_t us);
+    enum FrameMode { LEADING_EDGE, SAME_FRAME };
+    /** Function signature called once each frame after the update callback */
+    typedef void (*TriggerFunc)();
+    /** Function signature for a timer's input capture interrupt */
+    typedef void (*CaptureFunc)();
+    /** Run time of the update callback measured against the frame interval */
+    class FrameStats{
+    public:
+        /** shortest, longest and mean callback run time in microseconds */
+        uint16_t shortest, longest, mean;
+        /** frame interval in microseconds */
+        uint16_t period;
+        /** frames whose update was skipped because the callback overran */
+        uint16_t skipped;
+        /**
+         * Percent of the frame left over after the longest callback
+         * Negative when the callback has overrun the frame
+         */
+        int16_t headroom() const {
+            if(period == 0) return 0;
+            return ((int32_t)period - longest) * 100 / period;
+        }
+    };
+
     /**
-     * Turn off a previously enabled channel
-     * @param channel Channel index [0,MAX_OUTPUTS)
+     * A set of output channels timed by one 16-bit timer
+     * Every Generator has its own channels and refresh interval, so ESCs can
+     *     be refreshed at a few hundred hertz while servos on another
+     *     Generator stay at 50Hz
      */
-    void disable(uint8_t channel);
+    class Generator{
+    public:
+        /**
+         * Create a generator on `timer`; nothing is started until `begin` or
+         *     the first channel is enabled
+         * Generators should be global so they outlive the timer interrupts
+         */
+        Generator(Timer timer);
+        /**
+         * Begin generated servo signals on all enabled channels
+         * Calling after servo signals have been started will update the
+         *     refresh interval but will skip a frame of signal outputs
+         * @param refreshIntervalMicroseconds Microseconds between servo frames
+         */
+        void begin(uint16_t refreshIntervalMicroseconds
+                                                = DEFAULT_REFRESH_INTERVAL);
+        /**
+         * Run the timer freely at the full clock rate instead of in frames
+         * Pulses then only start when `trigger` is called, and pulse widths
+         *     have 1/16us resolution but must be shorter than 4ms
+         * Call before any channel is set
+         */
+        void beginTriggered();
+        /**
+         * Change a running generator's refresh interval at the start of the
+         *     next frame, without the skipped frame `begin` causes
+         * @param refreshIntervalMicroseconds Microseconds between servo frames
+         */
+        void setInterval(uint16_t refreshIntervalMicroseconds);
+        /**
+         * Set a previously enabled channel to a particular signal width
+         * @param channel Channel index [0,MAX_OUTPUTS)
+         * @param us      signal high time in microseconds
+         */
+        void set(uint8_t channel, uint16_t us);
+        /**
+         * Set a channel's signal width in timer ticks
+         * Ticks are 1/2us after `begin` and 1/16us after `beginTriggered`
+         * @param channel Channel index [0,MAX_OUTPUTS)
+         * @param ticks   signal high time in timer ticks
+         */
+        void setTicks(uint8_t channel, uint16_t ticks);
+        /**
+         * Turn off a previously enabled channel
+         * @param channel Channel index [0,MAX_OUTPUTS)
+         */
+        void disable(uint8_t channel);
+        /**
+         * Enable an unused channel and attach it to an arduino pin
+         * If the generator has not previously been started the channel
+         *     attachment will call `begin` with DEFAULT_REFRESH_INTERVAL
+         * Sets `pin` to output and updates the channel to write to `pin`
+         *     weather the channel was previously in use or not
+         * @param  channel Channel index [0,MAX_OUTPUTS)
+         * @param  pin     Arduino digital or analog pin
+         * @return         true if channel was newly attached
+         */
+        bool enable(uint8_t channel, int pin);
+        /** @return The lowest unused channel index, or -1 if all are used */
+        int8_t freeChannel();
+        /**
+         * Attach a function can be installed to update the servo setpoints
+         * It will be called at the start of each frame after the output
+         *     channels are written high, unless a previous call has not yet
+         *     completed
+         * Interrupts will be enabled when the callback starts
+         * @param callback The function to be called
+         */
+        void setUpdateCallback(UpdateFunc callback);
+        /**
+         * Attach a function to be called each frame as soon as the update
+         *     callback returns, or at the start of the frame if there is none
+         * It runs from the frame interrupt with interrupts disabled, so it can
+         *     start outputs that should follow the newest setpoints immediately
+         * @param trigger The function to be called
+         */
+        void setTriggerCallback(TriggerFunc trigger);
+        /**
+         * Select the order of work at the start of each frame
+         * In SAME_FRAME mode the deadline must leave room for the longest
+         *     pulse before the frame ends; by default it is 2.6ms before the
+         *     frame ends
+         * @param mode     LEADING_EDGE (default) or SAME_FRAME
+         * @param deadline Microseconds after frame start at which the pulses
+         *                 rise with the old setpoints; 0 for the default
+         */
+        void setFrameMode(FrameMode mode, uint16_t deadline = 0);
+        /**
+         * The longest delay seen between a scheduled falling edge and the
+         *     interrupt that produces it; this is how long other code kept
+         *     interrupts disabled, and how much longer a pulse was than
+         *     requested
+         * @param  reset Clear the recorded maximum after reading it
+         * @return       The delay in microseconds
+         */
+        uint16_t maxLatency(bool reset = false);
+        /**
+         * Timing of the update callback since `begin` or the last reset
+         * Use this to find how short the refresh interval can safely be
+         * @param  reset Clear the recorded timing after reading it
+         * @return       A snapshot of the callback timing
+         */
+        FrameStats frameStats(bool reset = false);
+        /**
+         * Start a pulse on every enabled channel now
+         * Used after `beginTriggered`; a pulse still running from the last
+         *     trigger is left to finish instead. Interrupts must be off
+         */
+        void trigger();
+
+        /** Timer interrupt handlers; not for use outside the interrupts */
+        void isrCompareA();
+        void isrCompareB();
+        void isrCapture();
+    private:
+        struct Registers{
+            volatile uint8_t  *tccra, *tccrb, *tifr, *timsk;
+            volatile uint16_t *icr, *tcnt, *ocra, *ocrb;
+        };
+        static Registers registersFor(Timer timer);
+
+        class Output{
+        public:
+            Output(): highTime(0xffff), pinMask(0), pinReg(0) {}
+            uint16_t highTime;
+            uint8_t pinMask;
+            volatile uint8_t* pinReg;
+            void disable() volatile;
+            void setPin(int p) volatile;
+            bool enabled() const volatile { return pinMask != 0; }
+            void setHigh() const volatile { *pinReg |= pinMask; }
+            void setLow() const volatile { *pinReg &= ~pinMask; }
+        };
+        class Action{ //lawsuit
+        public:
+            uint16_t time;
+            uint8_t channel;
+        };
+        class PortMask{
+        public:
+            volatile uint8_t* reg;
+            uint8_t mask;
+        };
+        /**
+         * Falling edges sorted by time with an OFF sentinel at the end, and
+         * the pins to raise at frame start grouped by port register so every
+         * pin on a port rises at the same instant
+         */
+        class ActionTable{
+        public:
+            Action actions[MAX_OUTPUTS+1];
+            PortMask ports[MAX_OUTPUTS];
+            uint8_t numPorts;
+            void rebuildPorts(const volatile Output* output);
+            void update(const volatile Output* output,
+                        uint8_t channel, uint16_t time);
+        };
+
+        const Registers reg;
+        volatile Output output[MAX_OUTPUTS];
+        volatile uint8_t activeOutputs;
+        // the ISRs read tables[front]; edits go to the other table and are
+        // swapped in at the start of a frame
+        ActionTable tables[2];
+        volatile uint8_t front;
+        // the back table holds edits that have not been swapped in yet
+        volatile bool dirty;
+        // the back table is older than the front one and must be refreshed
+        volatile bool stale;
+        Action * volatile next;
+        // TCNT when this frame's pulses rose; falling edge times are offsets
+        volatile uint16_t frameBase;
+        // longest delay in timer ticks between OCRA matching and the ISR
+        volatile uint16_t maxLateTicks;
+
+        // function pointer and state guard for frame update callbacks
+        volatile UpdateFunc frameCallback;
+        volatile bool inFrameCallback;
+        volatile TriggerFunc triggerCallback;
+
+        // frame ordering; see setFrameMode
+        volatile FrameMode frameMode;
+        uint16_t requestedDeadline;
+        // timer ticks after frame start when the pulses must rise
+        volatile uint16_t deadlineTicks;
+        // set once this frame's pulses have started
+        volatile bool raised;
+        // ICR to switch to at the next frame start; 0 for no change
+        volatile uint16_t pendingInterval;
+
+        // counts frame starts so an overrunning callback's length is known
+        volatile uint8_t frameNumber;
+        // update callback timing in timer ticks; written with interrupts off
+        uint16_t skippedFrames;
+        uint16_t shortestTicks, longestTicks;
+        uint32_t totalTicks;
+        uint16_t timedFrames;
+
+        bool begun;
+        // free running and started by `trigger` instead of framed by ICR
+        bool triggered;
+        uint8_t ticksPerUs;
+
+        void editTable(uint8_t channel, uint16_t time, bool moved = false);
+        void updateDeadline();
+        void swapTables();
+        void raiseOutputs();
+        void runFrameCallback();
+        void clearStats();
+    };
+
     /**
-     * Enable an unused channel and attach it to an arduino pin
-     * If the servo generator has not previously been started with `begin` and
-     *     The channel attachment is successful, `begin` will be called with
-     *     DEFAULT_REFRESH_INTERVAL as the frame interval
-     * Sets `pin` to output and updates the channel to write to `pin` weather
-     *     The channel was previously in use or not
-     * @param  channel Channel index [0,MAX_OUTPUTS)
-     * @param  pin     Arduino digital or analog pin
-     * @return         true if channel was newly attached
+     * The generator on timer 1; the functions below and Servos created
+     *     without a generator use this one
      */
+    Generator& primary();
+
+    /** Set a channel on the primary generator; see Generator::set */
+    void set(uint8_t channel, uint16_t us);
+    /** Disable a channel on the primary generator; see Generator::disable */
+    void disable(uint8_t channel);
+    /** Enable a channel on the primary generator; see Generator::enable */
     bool enable(uint8_t channel, int pin);
-    /**
-     * Begin generated servo signals on all enabled channels
-     * Calling after servo signals have been started will update the refresh
-     *     interval but will skip a frame of signal outputs
-     * @param refreshIntervalMicroseconds Microseconds between servo frames
-     */
+    /** Start the primary generator; see Generator::begin */
     void begin(uint16_t refreshIntervalMicroseconds = DEFAULT_REFRESH_INTERVAL);
+    /** See Generator::setInterval */
+    void setInterval(uint16_t refreshIntervalMicroseconds);
+    /** See Generator::setUpdateCallback */
+    void setUpdateCallback(UpdateFunc callback);
+    /** See Generator::setTriggerCallback */
+    void setTriggerCallback(TriggerFunc trigger);
+    /** See Generator::setFrameMode */
+    void setFrameMode(FrameMode mode, uint16_t deadline = 0);
+    /** See Generator::maxLatency */
+    uint16_t maxLatency(bool reset = false);
+    /** See Generator::frameStats */
+    FrameStats frameStats(bool reset = false);
     /**
-     * Attach a function can be installed to update the servo setpoints
-     * It will be called at the start of each frame after the output channels
-     *     are written high, unless a previous call has not yet completed
-     * Interrupts will be enabled when the callback starts
-     * @param callback The function to be called
+     * Run `handler` from `timer`'s input capture interrupt when no Generator
+     *     has been created on that timer, for code that uses the timer itself
+     * @param timer   The timer whose capture interrupt to take
+     * @param handler Called from the interrupt; NULL to stop
      */
-    void setUpdateCallback(UpdateFunc callback);
+    void setCaptureHandler(Timer timer, CaptureFunc handler);
 
     class Servo{
+        Generator* generator;
         int8_t channel;
     public:
-        Servo();
+        /** @param gen The generator to take a channel from */
+        Servo(Generator& gen = primary());
         /**
          * Start generating servo signals on a given pin
          * Fails if the servo is already attached or there are no available
@@ -96,7 +356,7 @@ namespace ServoGenerator{
         void write(uint8_t sig){
             if(channel != -1)
                 // convert [0,180] to [600,2400]
-                set(channel, ((uint16_t)sig)*10 + 600);
+                generator->set(channel, ((uint16_t)sig)*10 + 600);
         }
         /**
          * Writes a specific microsecond value to the attached pin
@@ -104,7 +364,7 @@ namespace ServoGenerator{
          */
         void writeMicroseconds(uint16_t us){
             if(channel != -1)
-                set(channel, us);
+                generator->set(channel, us);
         }
     };
 }
@@ -3,7 +3,6 @@
 
 #include "Arduino.h"
 #include "SPI.h"
-#include "Wire.h"
 
 /*
 Copyright 2015 MINDS-i Inc.
@@ -35,6 +34,7 @@ Copyright 2015 MINDS-i Inc.
 
 
 #include "APM/APMRadioInput.h"
+#include "APM/OneShot.h"
 #include "APM/ServoGenerator.h"
 
 #include "comms/CommManager.h"
@@ -62,8 +62,10 @@ Copyright 2015 MINDS-i Inc.
 #include "input/APM/MPU6000.h"
 #include "input/APM/MS5611.h"
 #include "input/APM/Power.h"
+#include "input/AsyncTWI.h"
 #include "input/AxisTranslator.h"
 #include "input/InertialManager.h"
+#include "input/SBUSRadio.h"
 #include "input/Sensor.h"
 #include "input/SPIcontroller.h"
 #include "input/UM7.h"
@@ -78,9 +80,12 @@ Copyright 2015 MINDS-i Inc.
 #include "output/EMaxESC.h"
 #include "output/FlightStrategy.h"
 #include "output/HK_ESCOutputDevice.h"
+#include "output/MotorMixer.h"
 #include "output/OutputDevice.h"
+#include "output/OneShotESC.h"
 #include "output/OutputManager.h"
 #include "output/ServoOutputDevice.h"
+#include "output/ThrustTable.h"
 
 #include "storage/EEPROMlist.h"
 #include "storage/EEPROMstorage.h"
@@ -92,15 +97,23 @@ Copyright 2015 MINDS-i Inc.
 #include "storage/SRAMstorage.h"
 #include "storage/Storage.h"
 
+#include "util/BusScheduler.h"
 #include "util/byteConv.h"
 #include "util/callbackTemplate.h"
+#include "util/CpuLoad.h"
+#include "util/GyroTempTune.h"
 #include "util/HLAverage.h"
 #include "util/Interval.h"
+#include "util/LoopScheduler.h"
 #include "util/LTATune.h"
+#include "util/MemoryMonitor.h"
+#include "util/PeriodTuner.h"
 #include "util/PIDcontroller.h"
 #include "util/PIDexternaltime.h"
 #include "util/PIDparameters.h"
 #include "util/profile.h"
+#include "util/SetpointShaper.h"
 #include "util/StateTimer.h"
+#include "util/Trace.h"
 
 #endif
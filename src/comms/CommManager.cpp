@@ -11,7 +11,8 @@ CommManager::CommManager(HardwareSerial *inStream, Storage<float> *settings):
 		targetIndex(0),
 		waypointsLooped(false),
 		connectCallback(NULL),
-		eStopCallback(NULL) {
+		eStopCallback(NULL),
+		profileCallback(NULL) {
 	waypoints = new SRAMlist<Waypoint>(MAX_WAYPOINTS);
 }
 void
@@ -43,6 +44,7 @@ CommManager::rightMatch(const uint8_t* lhs, const uint8_t llen,
 void
 CommManager::processMessage(uint8_t* msg, uint8_t length){
 	if(!fletcher(msg, length)) return;
+	Trace::mark(Trace::COMM_MESSAGE, msg[0]);
 	messageType type = getMessageType(msg[0]);
 	switch(type){
 		case WAYPOINT:
@@ -154,6 +156,12 @@ CommManager::handleCommands(uint8_t a, uint8_t b){
 			if(b <= getTargetIndex()) retardTargetIndex();
 			if(waypoints->size()==0) cachedTarget = Waypoint();
 			break;
+		case PROFILE_REPORT:
+			if(profileCallback != NULL) profileCallback();
+			break;
+		case TRACE_ENABLE:
+			if(b <= Trace::ONE_SHOT) Trace::setMode((Trace::Mode)b);
+			break;
 	}
 }
 void
@@ -234,6 +242,10 @@ CommManager::setEStopCallback(void (*call)(void)){
 	eStopCallback = call;
 }
 void
+CommManager::setProfileCallback(void (*call)(void)){
+	profileCallback = call;
+}
+void
 CommManager::onConnect(){
 	for(int i=0; i<MAX_SETTINGS; i++){
 		sendSetting(i, getSetting(i));
@@ -286,3 +298,15 @@ CommManager::sendError(char const * msg){
 	uint8_t len = strnlen(msg, 0xFF);
 	sendString(Protocol::stringSubtype(ERROR), msg, len);
 }
+bool
+CommManager::sendTrace(){
+	uint8_t data[TRACE_RECORDS*Trace::RECORD_SIZE];
+	// only send when the whole message fits in the serial buffer, so the
+	// trace waits on other traffic instead of holding up the loop
+	const int size = HEADER_SIZE + 1 + sizeof(data) + 2 + FOOTER_SIZE;
+	if(stream->availableForWrite() < size) return false;
+	uint8_t len = Trace::pack(data, sizeof(data));
+	if(len == 0) return false;
+	sendString(Protocol::stringSubtype(TRACE), (const char*)data, len);
+	return true;
+}
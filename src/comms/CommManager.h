@@ -12,10 +12,13 @@
 #include "storage/SRAMlist.h"
 #include "storage/Storage.h"
 #include "util/byteConv.h"
+#include "util/Trace.h"
 
 using namespace Protocol;
 
 const uint8_t BUFF_LEN = 32;
+//most Trace records sent in one message by sendTrace
+const uint8_t TRACE_RECORDS = 8;
 
 //Settings -- container supplied by outside world
 //write setting
@@ -41,6 +44,7 @@ class CommManager{
 	bool				waypointsLooped;
 	void (*connectCallback)(void);
 	void (*eStopCallback)(void);
+	void (*profileCallback)(void);
 public:
 	CommManager(HardwareSerial *inStream, Storage<float> *settings);
 	bool 	 loopWaypoints();
@@ -50,6 +54,7 @@ public:
 	void	 sendTelem(uint8_t id , float value);
 	void	 setConnectCallback(void (*call)(void));
 	void	 setEStopCallback(void (*call)(void));
+	void	 setProfileCallback(void (*call)(void));
 	void 	 clearWaypointList();
 	void  	 requestResync();
 	void  	 update();
@@ -60,6 +65,7 @@ public:
 	void     sendString(int type, const char* msg, uint8_t len);
 	void 	 sendString(char const * msg);
 	void 	 sendError(char const * msg);
+	bool	 sendTrace();
 	Waypoint getTargetWaypoint();
 	Waypoint getWaypoint(uint16_t index);
 private:
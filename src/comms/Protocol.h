@@ -40,7 +40,8 @@ namespace Protocol{
                       COMMAND      = 2 };
 
     enum stringSubtype{ ERROR = 0,
-                        STATE = 1 };
+                        STATE = 1,
+                        TRACE = 2 };
 
     enum telemetryType{ LATITUDE    = 0,
                         LONGITUDE   = 1,
@@ -58,13 +59,26 @@ namespace Protocol{
                         RDGEAR      = 13,
                         HOMELATITUDE = 14,
                         HOMELONGITUDE = 15,
-                        HOMEALTITUDE = 16 };
+                        HOMEALTITUDE = 16,
+                        LOOPMEAN    = 17,
+                        LOOPMAX     = 18,
+                        LOOPHEADROOM = 19,
+                        LOOPSKIPPED = 20,
+                        LOOPPERIOD  = 21,
+                        ARMING      = 22,
+                        READYTIME   = 23,
+                        CPULOAD     = 24,
+                        ISRLOAD     = 25,
+                        STACKFREE   = 26,
+                        HEAPSIZE    = 27 };
 
     enum commandType{ ESTOP           = 0,
                       TARGET          = 1,
                       LOOPING         = 2,
                       CLEAR_WAYPOINTS = 3,
-                      DELETE_WAYPOINT = 4 };
+                      DELETE_WAYPOINT = 4,
+                      PROFILE_REPORT  = 5,
+                      TRACE_ENABLE    = 6 };
 
     const uint8_t  MAX_WAYPOINTS    = 64;
     const uint8_t  MAX_SETTINGS     = NUM_STORED_RECORDS;//taken from eepromconfig
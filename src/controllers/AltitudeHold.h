@@ -28,8 +28,9 @@ private:
     float integralFactor;
     // landing detection variables
     bool minThrottleHit;
+    Interval::RepeatedInterval timer;
 public:
-    AltitudeHold() {}
+    AltitudeHold(): timer(UPDATE_INTERVAL) {}
     void setResponseFactor(float f) { responseFactor = f; }
     void setVelocityFactor(float f) { velocityFactor = f; }
     void setIntegralFactor(float f) { integralFactor = f; }
@@ -49,7 +50,6 @@ public:
      * @return Throttle value to apply to the craft [0,1]
      */
     float update(float targetAltitude, Altitude measurements){
-        static auto timer = Interval::every(UPDATE_INTERVAL);
         if(timer()) {
             float error = targetAltitude-measurements.getAltitude();
             float newIntegral = integral + error*DT;
@@ -1,30 +1,46 @@
 #include "util/PIDexternaltime.h"
 #include "util/PIDparameters.h"
+#include "util/SetpointShaper.h"
 #include "math/SpatialMath.h"
 #include "output/FlightStrategy.h"
+#include <util/atomic.h>
 
 class Horizon : public FlightStrategy {
 private:
     PIDexternaltime pitchPID, pError;
     PIDexternaltime  rollPID, rError;
     PIDexternaltime   yawPID, yError;
-    float pitch, roll, yaw, throttle;
+    // setpoints arrive at the main loop rate and are ramped at the frame rate
+    SetpointShaper pitch, roll, yaw;
+    float throttle;
+    // fraction of the setpoint ramp rate passed straight to the rate loops
+    float feedForward;
 public:
     Horizon(PIDparameters* pitchI, PIDparameters* pitchO,
             PIDparameters*  rollI, PIDparameters*  rollO,
             PIDparameters*   yawI, PIDparameters*   yawO ) :
                 pitchPID(pitchI), pError(pitchO),
                  rollPID( rollI), rError( rollO),
-                  yawPID(  yawI), yError(  yawO) {}
+                  yawPID(  yawI), yError(  yawO),
+                  yaw(true), throttle(0), feedForward(0) {}
+    /**
+     * Set how much of the setpoints' rate of change is added to the rate
+     *     loop setpoints, so they follow the sticks without waiting for the
+     *     attitude error to build up; 0 turns it off
+     */
+    void setFeedForward(float gain){ feedForward = gain; }
     void update(OrientationEngine& orientation, float ms, float (&torques)[4]){
+        const float pitchSet = pitch.update(ms);
+        const float rollSet  = roll.update(ms);
+        const float yawSet   = yaw.update(ms);
         //calculate outer loop
-        float p = pError.update(orientation.getPitch() - pitch, ms);
-        float r = rError.update(orientation.getRoll() - roll, ms);
-        float y = yError.update(distanceRadian(yaw,orientation.getYaw()), ms);
-        //set inner loops with outer calculations
-        pitchPID.set(p);
-        rollPID.set(r);
-        yawPID.set(y);
+        float p = pError.update(orientation.getPitch() - pitchSet, ms);
+        float r = rError.update(orientation.getRoll() - rollSet, ms);
+        float y = yError.update(distanceRadian(yawSet,orientation.getYaw()), ms);
+        //set inner loops with outer calculations and feed forward
+        pitchPID.set(p + feedForward*pitch.rate());
+        rollPID.set(r + feedForward*roll.rate());
+        yawPID.set(y + feedForward*yaw.rate());
         //set torques from inner PID loop calculations
         torques[0] = pitchPID.update(orientation.getPitchRate()*1024.f,ms);//1024 from rad/millisecond
         torques[1] = rollPID.update(orientation.getRollRate()*1024.f,ms);  //to rad/second
@@ -44,14 +60,19 @@ public:
         yawPID.set(0);
         yError.clearAccumulator();
         yError.set(0);
+        pitch.reset();
+        roll.reset();
+        yaw.reset();
     }
     void set(float (&setps)[4]){
         set(setps[0], setps[1], setps[2], setps[3]);
     }
     void set(float pitch, float roll, float yaw, float throttle){
-        this->pitch    = pitch;
-        this->roll     = roll;
-        this->yaw      = yaw;
-        this->throttle = min(throttle, 1.0);
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            this->pitch.set(pitch);
+            this->roll.set(roll);
+            this->yaw.set(yaw);
+            this->throttle = min(throttle, 1.0);
+        }
     }
 };
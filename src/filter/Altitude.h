@@ -13,6 +13,7 @@ private:
     // Filter gain variables
     float barometerGain;
     float velocityGain;
+    Interval::Timer timer;
 public:
     Altitude(){}
     void setBarometerGain(float g){ barometerGain = g; }
@@ -26,7 +27,6 @@ public:
     }
     /** Update altitude model */
     void update(float inputAltitude){
-        static auto timer = Interval::timer();
         uint32_t dt = timer();
         if(dt > UPDATE_INTERVAL){
             timer.reset();
@@ -31,6 +31,11 @@ public:
 	 *    can learn more about the inertial sensors errors
 	 */
 	virtual void calibrate(bool mode)=0;
+	/**
+	 * True once calibrate mode has learned enough to be turned off; engines
+	 *    without a confidence measure are always ready
+	 */
+	virtual bool calibrated(){ return true; }
     /**
      * Get Attitude quaternion that rotates global frame vectors into
      * the sensor frame
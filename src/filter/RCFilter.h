@@ -25,8 +25,17 @@ private:
     float accelGain;
     /** Weight applied to the magnetometer correction values */
     float magGain;
-    /** a count the readings stored in rateCal for averaging when calibrating */
+    /** a count of the readings in the running calibration statistics */
     float calTrack;
+    /** Running mean and sum of squared deviations (Welford) while calibrating */
+    Vec3 gyroMean, gyroM2;
+    Vec3 acclMean, acclM2;
+    /** Set from the isr once the gyro mean is confident; freezes the stats */
+    volatile bool calDone;
+    /** Number of times calibration restarted after detecting motion */
+    volatile uint16_t calRestarts;
+    void resetCalibration();
+    void trackCalibration(const Vec3& gyro, const Vec3& accl);
     /** Stores the most recent rotation rate reading */
     Vec3 rate;
     /** Stores the most recent pitch, roll, and yaw angle */
@@ -38,10 +47,22 @@ public:
          rateCal(0,0,0),
          attitude(),
          accelGain(gain), magGain(rGain),
+         calTrack(0), calDone(false), calRestarts(0),
          pitch(0), roll(0), yaw(0)
          {}
+    // Calibration finishes once the standard error of the mean gyro reading
+    // is below CAL_GYRO_ERROR on every axis and at least CAL_MIN_SAMPLES
+    // readings were collected; a single reading further than CAL_GYRO_MOTION
+    // or CAL_ACCL_MOTION from the running mean restarts it
+    static const float CAL_MIN_SAMPLES;
+    static const float CAL_GYRO_ERROR;  //radians per millisecond
+    static const float CAL_GYRO_MOTION; //radians per millisecond
+    static const float CAL_ACCL_MOTION; //G's
+    static const float CAL_ACCL_NOISE;  //G's standard deviation
     void update(InertialManager& sensors, float ms);
     void calibrate(bool mode);
+    bool calibrated(){ return calMode && calDone; }
+    uint16_t calibrationRestarts(){ return calRestarts; }
     Quaternion getAttitude(){ return attitude; }
     Vec3  getRate(){ return rate; }
     float getPitchRate(){ return rate[1]; }
@@ -59,21 +80,72 @@ RCFilter::updatePRY(){
     roll  = attitude.getRoll();
     yaw   = attitude.getYaw();
 }
+const float RCFilter::CAL_MIN_SAMPLES = 100;
+const float RCFilter::CAL_GYRO_ERROR  = toRad(0.02f)/1000.f;
+const float RCFilter::CAL_GYRO_MOTION = toRad(2.0f)/1000.f;
+const float RCFilter::CAL_ACCL_MOTION = 0.05f;
+const float RCFilter::CAL_ACCL_NOISE  = 0.02f;
 void
 RCFilter::calibrate(bool calibrate){
     if(calMode == true && calibrate == false){
-        // Apply the average measured gyroscope value as a rate calibration
-        if(calTrack != 0) {
-            rateCal = rateCal/calTrack;
-        }
+        // Apply the mean gyroscope reading as a rate calibration only if it
+        // was trusted; otherwise keep the previous calibration
+        if(calDone) rateCal = Vec3()-gyroMean;
     } else if (calMode == false && calibrate == true){
-        // reset the calibration track variables
-        rateCal  = Vec3();
-        calTrack = 0;
+        resetCalibration();
+        calRestarts = 0;
     }
     calMode = calibrate;
 }
 void
+RCFilter::resetCalibration(){
+    gyroMean = Vec3();
+    gyroM2   = Vec3();
+    acclMean = Vec3();
+    acclM2   = Vec3();
+    calTrack = 0;
+    calDone  = false;
+}
+void
+RCFilter::trackCalibration(const Vec3& gyro, const Vec3& accl){
+    if(calDone) return;
+
+    Vec3 g = gyro;
+    Vec3 a = accl;
+    Vec3 dG = g - gyroMean;
+    Vec3 dA = a - acclMean;
+
+    // Any reading far from the running mean means the craft was moved
+    if(calTrack >= 1){
+        for(int i=0; i<3; i++){
+            if(fabs(dG[i]) > CAL_GYRO_MOTION || fabs(dA[i]) > CAL_ACCL_MOTION){
+                resetCalibration();
+                calRestarts++;
+                return;
+            }
+        }
+    }
+
+    // Welford update of the running mean and squared deviations
+    calTrack++;
+    gyroMean += dG/calTrack;
+    acclMean += dA/calTrack;
+    for(int i=0; i<3; i++){
+        gyroM2[i] += dG[i]*(g[i]-gyroMean[i]);
+        acclM2[i] += dA[i]*(a[i]-acclMean[i]);
+    }
+    if(calTrack < CAL_MIN_SAMPLES) return;
+
+    // squared standard error of the mean is variance/n
+    const float n = calTrack;
+    const float maxError = CAL_GYRO_ERROR*CAL_GYRO_ERROR*n*(n-1);
+    const float maxNoise = CAL_ACCL_NOISE*CAL_ACCL_NOISE*(n-1);
+    for(int i=0; i<3; i++){
+        if(gyroM2[i] > maxError || acclM2[i] > maxNoise) return;
+    }
+    calDone = true;
+}
+void
 RCFilter::update(InertialManager& sensors, float dt){
     // This filter works by integrating the gyroscope while applying corrections
     // as rotation rate vectors derived from the absolute angular position
@@ -106,9 +178,8 @@ RCFilter::update(InertialManager& sensors, float dt){
         // Apply gyro drift calibration terms
         rate += rateCal;
     } else {
-        // Integrate gyroscope readings
-        rateCal -= rate;
-        calTrack++;
+        // Track the gyroscope mean and check for stillness
+        trackCalibration(rate, *sensors.acclRef());
     }
 
     // Integrate the gyroscope rate
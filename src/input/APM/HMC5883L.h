@@ -1,3 +1,4 @@
+#include "input/AsyncTWI.h"
 #include "input/InertialManager.h"
 #include "input/Sensor.h"
 #include "util/LTATune.h"
@@ -9,13 +10,25 @@ class HMC5883L : public InertialVec {
 protected:
     static const uint8_t HMC_I2C_ADDR   = 0x1E;
     static const uint8_t HMC_STATUS_REG = 0x09;
+    static const uint8_t HMC_MODE_REG   = 0x02;
+    static const uint8_t HMC_DATA_REG   = 0x03;
+    static const uint8_t STARTUP_TIME   = 10; //milliseconds
     LTATune LTA;
     uint8_t address;
     bool isTrueHMC5883L;
+    // the reading started last frame, consumed on the next update
+    uint8_t magData[6];
+    uint8_t singleMode;
+    AsyncTWI::Transfer magRead;
+    AsyncTWI::Transfer magTrigger;
+    void setupTransfers();
+    static void decode(const uint8_t* d, int& x, int& y, int& z);
 public:
-    HMC5883L(): address(HMC_I2C_ADDR) {}
-    HMC5883L(uint8_t addr): address(addr) {}
+    HMC5883L(): address(HMC_I2C_ADDR), singleMode(0x01) { setupTransfers(); }
+    HMC5883L(uint8_t addr): address(addr), singleMode(0x01) { setupTransfers(); }
     void  begin();
+    void  startInit();
+    boolean continueInit(uint32_t dt);
     void  end();
     bool  checkGoodValues();
     Sensor::Status  status();
@@ -26,20 +39,35 @@ public:
     float getAzimuth();
 };
 void
-HMC5883L::begin(){
-    Wire.begin();
-    Wire.setClock(800000L);
-    delay(10);
-
-    Wire.beginTransmission(address);
-    Wire.write((uint8_t) 0x00);
-    Wire.write((uint8_t) 0x70);
-    Wire.endTransmission();
+HMC5883L::setupTransfers(){
+    magRead.address = address;
+    magRead.reg     = HMC_DATA_REG;
+    magRead.data    = magData;
+    magRead.length  = 6;
+    magRead.write   = false;
 
-    Wire.beginTransmission(address);
-    Wire.write((uint8_t) 0x01);
-    Wire.write((uint8_t) 0x00);
-    Wire.endTransmission();
+    magTrigger.address = address;
+    magTrigger.reg     = HMC_MODE_REG;
+    magTrigger.data    = &singleMode;
+    magTrigger.length  = 1;
+    magTrigger.write   = true;
+}
+void
+HMC5883L::begin(){
+    startInit();
+    delay(STARTUP_TIME);
+    continueInit(STARTUP_TIME);
+}
+void
+HMC5883L::startInit(){
+    AsyncTWI::begin(800000L);
+}
+boolean
+HMC5883L::continueInit(uint32_t dt){
+    if(dt < STARTUP_TIME) return false;
+    AsyncTWI::writeRegister(address, 0x00, 0x70);
+    AsyncTWI::writeRegister(address, 0x01, 0x00);
+    return true;
 }
 void
 HMC5883L::tune(LTATune t){
@@ -56,12 +84,8 @@ HMC5883L::checkGoodValues() {
 Sensor::Status
 HMC5883L::status(){
     isTrueHMC5883L = true;
-    Wire.beginTransmission(address);
-    Wire.write((uint8_t)0x09);
-    Wire.endTransmission();
-    Wire.requestFrom(address, (uint8_t)0x01);
-    if(Wire.available()>=1){
-        uint8_t status = Wire.read();
+    uint8_t status;
+    if(AsyncTWI::readRegisters(address, HMC_STATUS_REG, 1, &status)){
         if((status&0x3) == 1) return Sensor::OK;
     }
     isTrueHMC5883L = false;//bad return value either compass failed or is clone. Set compass as clone.
@@ -75,36 +99,34 @@ HMC5883L::calibrate(){
 }
 void
 HMC5883L::update(InertialManager& man, Translator axis){
-    int m[3];
-    rawValues(m[0], m[1], m[2]);
-    float M[3];
-    LTA.calibrate<int>(m,M);
-    man.mag = axis(M);
+    if(magRead.done()){
+        int m[3];
+        decode(magData, m[0], m[1], m[2]);
+        float M[3];
+        LTA.calibrate<int>(m,M);
+        man.mag = axis(M);
+    }
+    // start the next reading; it finishes on the bus while the frame runs
+    if(!magRead.pending() && !magTrigger.pending()){
+        AsyncTWI::queue(magRead);
+        if(isTrueHMC5883L) AsyncTWI::queue(magTrigger);
+    }
+}
+void
+HMC5883L::decode(const uint8_t* d, int& x, int& y, int& z){
+    // data registers are big endian in x, z, y order
+    x = (int16_t)(((uint16_t)d[0])<<8 | d[1]);
+    z = (int16_t)(((uint16_t)d[2])<<8 | d[3]);
+    y = (int16_t)(((uint16_t)d[4])<<8 | d[5]);
 }
 void
 HMC5883L::rawValues(int& x, int& y, int& z) {
-    Wire.beginTransmission(address);
     if (isTrueHMC5883L) {
-        Wire.write((uint8_t)0x02);
-        Wire.write((uint8_t)0x01);
-    }
-    else {
-        Wire.write((uint8_t)0x03);
+        AsyncTWI::writeRegister(address, HMC_MODE_REG, singleMode);
     }
-    Wire.endTransmission();
-
-
-    Wire.requestFrom(address, (uint8_t)0x06);
-    if(Wire.available()>=6){
-        uint8_t* d = (uint8_t*) &x;
-        d[1] = Wire.read();
-        d[0] = Wire.read();
-        d = (uint8_t*) &z;
-        d[1] = Wire.read();
-        d[0] = Wire.read();
-        d = (uint8_t*) &y;
-        d[1] = Wire.read();
-        d[0] = Wire.read();
+    uint8_t data[6];
+    if(AsyncTWI::readRegisters(address, HMC_DATA_REG, 6, data)){
+        decode(data, x, y, z);
     }
 }
 float
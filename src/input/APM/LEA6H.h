@@ -19,14 +19,26 @@ protected:
                           uint16_t len, const uint8_t* buf);
     void calcChecksum(const uint8_t* msg, uint8_t len,
                       uint8_t &c_a, uint8_t &c_b);
+    //bytes a UBX message adds around its payload
+    const static uint8_t UBX_OVERHEAD = 8;
+    //microseconds to wait after the transmit buffer empties for the bytes in
+    //the UART to finish; two bytes at 9600 baud take 2.1ms
+    const static uint16_t SHIFT_OUT_TIME = 3000;
     HardwareSerial &stream;
     NMEA            parser;
+    //progress through the startup configuration messages
+    uint8_t  initStep;
+    int      emptyRoom;
+    //micros() when the transmit buffer emptied
+    uint32_t drainTime;
 public:
-    LEA6H(HardwareSerial &port): stream(port), parser(stream) {}
+    LEA6H(HardwareSerial &port): stream(port), parser(stream), initStep(0) {}
     #if defined(__AVR_ATmega2560__)
-    LEA6H(): stream(Serial1), parser(stream) {}
+    LEA6H(): stream(Serial1), parser(stream), initStep(0) {}
     #endif
     void begin();
+    void startInit();
+    boolean continueInit(uint32_t dt);
     void end() {}
     Sensor::Status status();
     void calibrate();
@@ -51,13 +63,49 @@ LEA6H::status(){
 }
 void
 LEA6H::begin(){
+    startInit();
+    uint32_t start = millis();
+    while(!continueInit(millis()-start));
+}
+void
+LEA6H::startInit(){
     stream.begin(9600);
+    emptyRoom = stream.availableForWrite();
     sendUBloxMessage(0x06, 0x00, 0x0014, CFG_PRT);
-    stream.flush();
-    stream.begin(38400);
-    sendUBloxMessage(0x06, 0x01, 0x0003, GPRMC_On);
-    sendUBloxMessage(0x06, 0x17, 0x0004, CFG_NMEA);
-    sendUBloxMessage(0x06, 0x24, 0x0024, Pedestrian_Mode);
+    initStep = 0;
+}
+boolean
+LEA6H::continueInit(uint32_t dt){
+    if(initStep == 0){
+        // wait for the port configuration to be sent at the old baud rate
+        if(stream.availableForWrite() < emptyRoom) return false;
+        drainTime = micros();
+        initStep++;
+    }
+    if(initStep == 1){
+        // the UART's data register and shift register still hold the last
+        // bytes after the buffer empties
+        if(micros() - drainTime < SHIFT_OUT_TIME) return false;
+        stream.begin(38400);
+        initStep++;
+    }
+    // queue each message only when it fits, so writing never blocks
+    if(initStep == 2){
+        if(stream.availableForWrite() < UBX_OVERHEAD + 0x0003) return false;
+        sendUBloxMessage(0x06, 0x01, 0x0003, GPRMC_On);
+        initStep++;
+    }
+    if(initStep == 3){
+        if(stream.availableForWrite() < UBX_OVERHEAD + 0x0004) return false;
+        sendUBloxMessage(0x06, 0x17, 0x0004, CFG_NMEA);
+        initStep++;
+    }
+    if(initStep == 4){
+        if(stream.availableForWrite() < UBX_OVERHEAD + 0x0024) return false;
+        sendUBloxMessage(0x06, 0x24, 0x0024, Pedestrian_Mode);
+        initStep++;
+    }
+    return true;
 }
 void
 LEA6H::calibrate(){
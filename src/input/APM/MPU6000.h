@@ -3,6 +3,7 @@
 #include "input/SPIcontroller.h"
 #include "input/AxisTranslator.h"
 #include "util/byteConv.h"
+#include "util/GyroTempTune.h"
 #include "util/LTATune.h"
 #include <SPI.h>
 #include "MPUregs.h"
@@ -18,11 +19,24 @@ class MPU6000 : public InertialVec {
 protected:
     static const uint8_t  APM26_CS_PIN    = 53;
     static const uint16_t CAL_SAMPLE_SIZE = 200; //for gyro calibration
+    static const uint16_t RESET_TIME = 100; //milliseconds after a chip reset
     static const float SAMPLE_RATE;//sample at 200Hz
     static const float dPlsb;//+- 2000 dps per least sig bit, in ms
     static const float GYRO_CONVERSION_FACT;
+    static const float TEMP_SCALE; //celsius per least sig bit
+    static const float TEMP_OFFSET;
     SPIcontroller spiControl;
     LTATune LTA;
+    GyroTempTune gyroTemp;
+    //gyro bias is only re-evaluated when the temperature changes enough
+    //to move the high bits of the raw temperature reading
+    static const uint8_t TEMP_KEY_SHIFT = 4;
+    int16_t lastTemp;
+    int16_t tempKey;
+    float   gyroBias[3];
+    //returned again if the SPI bus is held when a reading is requested
+    rawData lastData;
+    void    updateGyroBias(int16_t rawTemp);
     bool    writeTo(uint8_t addr, uint8_t msg);
     bool    writeTo(uint8_t addr, uint8_t len, uint8_t* msg);
     bool    readFrom(uint8_t addr, uint8_t len, uint8_t* data);
@@ -30,17 +44,25 @@ protected:
 public:
     //clock speed 8E6 instead of default(4E6) makes readSensors about 50% faster
     MPU6000()
-        : spiControl(APM26_CS_PIN, SPISettings(8E6, MSBFIRST, SPI_MODE0)) {}
+        : spiControl(APM26_CS_PIN, SPISettings(8E6, MSBFIRST, SPI_MODE0)),
+          lastTemp(0), tempKey(0), gyroBias{0,0,0}, lastData() {}
     MPU6000(uint8_t chip_select)
-        : spiControl(chip_select , SPISettings(8E6, MSBFIRST, SPI_MODE0)) {}
+        : spiControl(chip_select , SPISettings(8E6, MSBFIRST, SPI_MODE0)),
+          lastTemp(0), tempKey(0), gyroBias{0,0,0}, lastData() {}
     void begin();
     void end();
     Sensor::Status status();
     void calibrate();
+    void startInit();
+    boolean continueInit(uint32_t dt);
     void update(InertialManager& man, Translator axis);
     //end of sensor interface
     void getSensors(int16_t (&accl)[3], int16_t (&gyro)[3]);
+    void getSensors(int16_t (&accl)[3], int16_t (&gyro)[3], int16_t& temp);
     void tuneAccl(LTATune t);
+    void tuneGyroTemp(GyroTempTune t);
+    static float celsiusFromRaw(int16_t temp);
+    float getCelsius();
     float acclX();
     float acclY();
     float acclZ();
@@ -53,12 +75,17 @@ public:
 const float MPU6000::SAMPLE_RATE = 200; //sample at 200Hz
 const float MPU6000::dPlsb = 2.f*(2.f/65535.f);
 const float MPU6000::GYRO_CONVERSION_FACT =  2.f*(2.f/65535.f) *PI/180.l;
+const float MPU6000::TEMP_SCALE  = 1.f/340.f; //from the MPU6000 register map
+const float MPU6000::TEMP_OFFSET = 36.53f;
 rawData
 MPU6000::readSensors(){
-    //Note: its faster to read and ignore temp than make two transfers
+    //Note: its faster to read temp with the rest than make two transfers
     //Note: this is unrolled for efficiency
+    //Note: if the bus is held by the code this interrupted, the previous
+    //      reading is returned instead; lastData is only written once the
+    //      bus is free again so that reading is never half updated
+    if(!spiControl.capture()) return lastData;
     rawData data;
-    spiControl.capture();
     SPI.transfer(REG_DATA_START | 0x80); //last bit set to specify a read
     //the order in memory is accl x,y,z; temp; gyro x,y,z
     data.bytes[1]  = SPI.transfer(0); data.bytes[0]  = SPI.transfer(0);
@@ -69,18 +96,19 @@ MPU6000::readSensors(){
     data.bytes[11] = SPI.transfer(0); data.bytes[10] = SPI.transfer(0);
     data.bytes[13] = SPI.transfer(0); data.bytes[12] = SPI.transfer(0);
     spiControl.release();
+    lastData = data;
     return data;
 }
 bool
 MPU6000::readFrom(uint8_t addr, uint8_t len, uint8_t* data){
-    spiControl.capture();
+    if(!spiControl.capture()) return false;
     SPI.transfer(addr | 0x80); //last bit set to specify a read
     for(int i=0; i<len; i++) data[i] = SPI.transfer(0);
     return spiControl.release();
 }
 bool
 MPU6000::writeTo(uint8_t addr, uint8_t len, uint8_t* msg){
-    spiControl.capture();
+    if(!spiControl.capture()) return false;
     SPI.transfer(addr & ~0x80); //clear last bit to specify a write
     for(int i=0; i<len; i++) SPI.transfer(msg[i]);
     return spiControl.release();
@@ -89,13 +117,43 @@ bool
 MPU6000::writeTo(uint8_t addr, uint8_t msg){
     return writeTo(addr, 1, &msg);
 }
+void
+MPU6000::updateGyroBias(int16_t rawTemp){
+    lastTemp = rawTemp;
+    int16_t key = rawTemp >> TEMP_KEY_SHIFT;
+    if(key == tempKey) return;
+    tempKey = key;
+    float celsius = celsiusFromRaw(rawTemp);
+    for(int i=0; i<3; i++) gyroBias[i] = gyroTemp.bias(i, celsius);
+}
 // ---- public functions below -------------------------------------------------
 void
 MPU6000::tuneAccl(LTATune t){
     LTA = t;
 }
 void
+MPU6000::tuneGyroTemp(GyroTempTune t){
+    gyroTemp = t;
+    //force the bias to be recalculated on the next reading
+    tempKey = ~(lastTemp >> TEMP_KEY_SHIFT);
+    updateGyroBias(lastTemp);
+}
+float
+MPU6000::celsiusFromRaw(int16_t temp){
+    return ((float)temp)*TEMP_SCALE + TEMP_OFFSET;
+}
+float
+MPU6000::getCelsius(){
+    return celsiusFromRaw(lastTemp);
+}
+void
 MPU6000::begin(){
+    startInit();
+    delay(RESET_TIME);
+    continueInit(RESET_TIME);
+}
+void
+MPU6000::startInit(){
     // Turn off barometer SPI line
     // Without this, running the MPU without instancing a MS5611 will fail
     // Only applies to APM2.* hardware though
@@ -103,13 +161,17 @@ MPU6000::begin(){
     digitalWrite(40, HIGH);
 
     writeTo(REG_PWR_MGMT_1  , BIT_H_RESET); //chip reset
-    delay(100);
+}
+boolean
+MPU6000::continueInit(uint32_t dt){
+    if(dt < RESET_TIME) return false;
     writeTo(REG_PWR_MGMT_1  , MPU_CLK_SEL_PLLGYROZ); //set GyroZ clock
     writeTo(REG_USER_CTRL   , BIT_I2C_DIS); //Disable I2C as recommended on datasheet
     writeTo(REG_SMPLRT_DIV  , ((1000/SAMPLE_RATE)-1) ); // Set Sample rate; 1khz/(value+1) = (rate)Hz
     writeTo(REG_CONFIG      , BITS_DLPF_CFG_188HZ); //set low pass filter to 188hz
     writeTo(REG_GYRO_CONFIG , BITS_FS_2000DPS); //Gyro scale 1000º/s
     writeTo(REG_ACCEL_CONFIG, 0x08); //Accel scale 4g
+    return true;
 }
 void
 MPU6000::end(){
@@ -119,7 +181,7 @@ MPU6000::status(){
     /*#MPUFAIL No response or incorrect WHO_AM_I response from the MPU */
 
     //poll WHO_AM_I for the correct value to see if its an MPU is present
-    uint8_t buf[1];
+    uint8_t buf[1] = {0};
     readFrom(REG_WHOAMI, 1, buf);
     if(buf[0] == WHOIIS) return Sensor::OK;
     return Sensor::BAD("MPUFAIL");
@@ -131,13 +193,14 @@ MPU6000::calibrate(){
 void
 MPU6000::update(InertialManager& man, Translator axis){
     rawData data = readSensors();
+    updateGyroBias(data.temp);
 
     float accl[3];
     LTA.calibrate<int16_t>(data.accl, accl);
 
     float gyro[3];
     for(int i=0; i<3; i++){
-        gyro[i] = (((float)data.gyro[i])*GYRO_CONVERSION_FACT);
+        gyro[i] = (((float)data.gyro[i])-gyroBias[i])*GYRO_CONVERSION_FACT;
     }
 
     man.gyro = axis(gyro);
@@ -145,11 +208,18 @@ MPU6000::update(InertialManager& man, Translator axis){
 }
 void
 MPU6000::getSensors(int16_t (&accl)[3], int16_t (&gyro)[3]){
+    int16_t temp;
+    getSensors(accl, gyro, temp);
+}
+void
+MPU6000::getSensors(int16_t (&accl)[3], int16_t (&gyro)[3], int16_t& temp){
     rawData data = readSensors();
     for (int i = 0; i < 3; i++){
         accl[i] = data.accl[i];
         gyro[i] = data.gyro[i];
     }
+    temp = data.temp;
+    lastTemp = data.temp;
 }
 float
 MPU6000::acclX(){
@@ -169,16 +239,19 @@ MPU6000::acclZ(){
 float
 MPU6000::gyroX(){
     rawData data = readSensors();
-    return (((float)data.gyro[0])*GYRO_CONVERSION_FACT);
+    updateGyroBias(data.temp);
+    return (((float)data.gyro[0])-gyroBias[0])*GYRO_CONVERSION_FACT;
 }
 float
 MPU6000::gyroY(){
     rawData data = readSensors();
-    return (((float)data.gyro[1])*GYRO_CONVERSION_FACT);
+    updateGyroBias(data.temp);
+    return (((float)data.gyro[1])-gyroBias[1])*GYRO_CONVERSION_FACT;
 }
 float
 MPU6000::gyroZ(){
     rawData data = readSensors();
-    return (((float)data.gyro[2])*GYRO_CONVERSION_FACT);
+    updateGyroBias(data.temp);
+    return (((float)data.gyro[2])-gyroBias[2])*GYRO_CONVERSION_FACT;
 }
 
@@ -32,6 +32,8 @@ protected:
     // 0.54, 1.06, 2.08, 4.13, 8.22 milliseconds
     const static uint8_t  OSR_RATIO = 0x08;
     const static uint16_t OSR_DELAY = 10000; // in microseconds
+    // the PROM can be read 2.8ms after a reset
+    const static uint8_t  RESET_TIME = 3; // in milliseconds
 
     //calibration terms stored in ms5611 prom
     uint16_t SENS_T1;
@@ -45,47 +47,52 @@ protected:
     SPIcontroller spiController;
     uint16_t  tempCycle;
     uint32_t  readyTime;
+    //a conversion has been started and its result not read yet
+    bool      converting;
     int32_t   dT, P;
     uint16_t  TEMP_DUTY_CYCLE;
 
-    void     sendCommand(uint8_t command);
-    uint32_t get24from(uint8_t prom_addr);
-    uint16_t get16from(uint8_t prom_addr);
+    //these return false without touching the bus if it is already held
+    bool     sendCommand(uint8_t command);
+    bool     get24from(uint8_t prom_addr, uint32_t& value);
+    bool     get16from(uint8_t prom_addr, uint16_t& value);
+    bool     readPROM();
     void     calculateP (uint32_t D1);
     void     calculateDT(uint32_t D2);
 public:
     MS5611()
         : spiController(APM26_CS_PIN, SPISettings(8E6, MSBFIRST, SPI_MODE0)),
-          TEMP_DUTY_CYCLE(2) {}
+          converting(false), TEMP_DUTY_CYCLE(2) {}
     MS5611(uint8_t cs_pin)
         : spiController(cs_pin, SPISettings(8E6, MSBFIRST, SPI_MODE0)),
-          TEMP_DUTY_CYCLE(2) {}
+          converting(false), TEMP_DUTY_CYCLE(2) {}
     void begin();
     void end();
     void update();
     Sensor::Status status();
     void calibrate();
+    boolean continueInit(uint32_t dt);
     void setTempDutyCycle(uint16_t cycle);
     float getPascals();
     float getMilliBar();
     float getCelsius(); // returns celsius
     float getAltitude(); // return feet
 };
-void
+bool
 MS5611::sendCommand(uint8_t cmd){
-    spiController.capture();
+    if(!spiController.capture()) return false;
     SPI.transfer(cmd);
-    spiController.release();
+    return spiController.release();
 }
-uint32_t
-MS5611::get24from(uint8_t prom_addr){
+bool
+MS5611::get24from(uint8_t prom_addr, uint32_t& result){
     uint8_t tmp[4];
     tmp[0] = prom_addr;
     tmp[1] = 0;
     tmp[2] = 0;
     tmp[3] = 0;
 
-    spiController.capture();
+    if(!spiController.capture()) return false;
     SPI.transfer(tmp, 4);
     spiController.release();
 
@@ -95,24 +102,27 @@ MS5611::get24from(uint8_t prom_addr){
     value.bytes[2] = tmp[1];
     //tmp[0] is a crc checksum
 
-    return value.l;
+    result = value.l;
+    return true;
 }
-uint16_t
-MS5611::get16from(uint8_t prom_addr){
+bool
+MS5611::get16from(uint8_t prom_addr, uint16_t& result){
     uint8_t tmp[3];
     tmp[0] = prom_addr;
     tmp[1] = 0;
     tmp[2] = 0;
 
-    spiController.capture();
+    if(!spiController.capture()) return false;
     SPI.transfer(tmp, 3);
     spiController.release();
     //tmp[0] is a crc checksum
-    return ((uint16_t) tmp[1] << 8 ) | ( tmp[2] );
+    result = ((uint16_t) tmp[1] << 8 ) | ( tmp[2] );
+    return true;
 }
 void
 MS5611::begin(){
     sendCommand(RESET);
+    converting = false;
     readyTime = micros();
     tempCycle = TEMP_DUTY_CYCLE; //get temperature first
 }
@@ -123,14 +133,24 @@ Sensor::Status
 MS5611::status(){
     return Sensor::OK;
 }
+bool
+MS5611::readPROM(){
+    return get16from(ADDR_SENS_T1,  SENS_T1 )
+        && get16from(ADDR_OFF_T1,   OFF_T1  )
+        && get16from(ADDR_TCS,      TCS     )
+        && get16from(ADDR_TCO,      TCO     )
+        && get16from(ADDR_T_REF,    T_REF   )
+        && get16from(ADDR_TEMPSENS, TEMPSENS);
+}
 void
 MS5611::calibrate(){
-    SENS_T1  = get16from(ADDR_SENS_T1 );
-    OFF_T1   = get16from(ADDR_OFF_T1  );
-    TCS      = get16from(ADDR_TCS     );
-    TCO      = get16from(ADDR_TCO     );
-    T_REF    = get16from(ADDR_T_REF   );
-    TEMPSENS = get16from(ADDR_TEMPSENS);
+    readPROM();
+}
+boolean
+MS5611::continueInit(uint32_t dt){
+    if(dt < RESET_TIME) return false;
+    // try again next time if the bus was held
+    return readPROM();
 }
 void
 MS5611::setTempDutyCycle(uint16_t cycle){
@@ -138,23 +158,30 @@ MS5611::setTempDutyCycle(uint16_t cycle){
 }
 void
 MS5611::update(){
+    // skip this update if the code that was interrupted holds the SPI bus
+    if(SPIcontroller::busy()) return;
     if(micros() > readyTime){
         //get data
-        uint32_t tmp = get24from(ADC_READ_ADDR);
-        if(tempCycle == 0){
-            calculateDT(tmp);
-        } else {
-            calculateP(tmp);
+        if(converting){
+            uint32_t tmp;
+            if(!get24from(ADC_READ_ADDR, tmp)) return;
+            converting = false;
+            if(tempCycle == 0){
+                calculateDT(tmp);
+            } else {
+                calculateP(tmp);
+            }
         }
 
         //send new request
         if(tempCycle >= TEMP_DUTY_CYCLE){
-            sendCommand(CMD_Temp + OSR_RATIO);
+            if(!sendCommand(CMD_Temp + OSR_RATIO)) return;
             tempCycle = 0;
         } else {
-            sendCommand(CMD_Pressure + OSR_RATIO);
+            if(!sendCommand(CMD_Pressure + OSR_RATIO)) return;
             tempCycle++;
         }
+        converting = true;
 
         readyTime = micros()+OSR_DELAY;
     }
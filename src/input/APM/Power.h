@@ -12,6 +12,7 @@ private:
     float lowPassConst = 0.05;
     float voltage, amperage;
     float lowWarningVoltage = -1;
+    float referenceVoltage = 0;
     Interval::SingleInterval warnTimer = Interval::elapsed(0);
     bool batteryLow;
     void update(){
@@ -33,6 +34,13 @@ public:
     void setLowVolt(float low){
         lowWarningVoltage = low;
     }
+    /**
+     * Set the battery voltage the motor outputs are tuned at; 0 turns off
+     *   voltage compensation
+     */
+    void setReferenceVoltage(float ref){
+        referenceVoltage = ref;
+    }
     float getVoltage(){
         update();
         return voltage;
@@ -74,6 +82,18 @@ public:
         */
         return max(1.0 - (lowWarningVoltage-voltage)/3.0, 0.0);
     }
+    /**
+     * The factor to multiply motor commands by for the motors to give the
+     *   thrust they would at the reference voltage, using the filtered
+     *   voltage from the last update. Motor speed follows the average voltage
+     *   the ESC applies, so as the battery sags the commands are raised by
+     *   the same ratio. 1 if compensation is off.
+     */
+    float voltageCompensation(){
+        if(referenceVoltage <= 0 || voltage <= 0) return 1.0;
+        // don't chase a bad reading or a pack that is nearly flat
+        return constrain(referenceVoltage/voltage, 1.0/1.3, 1.3);
+    }
 };
 
 #endif
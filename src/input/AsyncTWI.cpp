@@ -0,0 +1,250 @@
+#include "AsyncTWI.h"
+#include "util/CpuLoad.h"
+
+using namespace AsyncTWI;
+
+namespace {
+    // TWI status codes (TWSR with the prescalar bits masked)
+    constexpr uint8_t START        = 0x08;
+    constexpr uint8_t REP_START    = 0x10;
+    constexpr uint8_t MT_SLA_ACK   = 0x18;
+    constexpr uint8_t MT_SLA_NACK  = 0x20;
+    constexpr uint8_t MT_DATA_ACK  = 0x28;
+    constexpr uint8_t MT_DATA_NACK = 0x30;
+    constexpr uint8_t ARB_LOST     = 0x38;
+    constexpr uint8_t MR_SLA_ACK   = 0x40;
+    constexpr uint8_t MR_SLA_NACK  = 0x48;
+    constexpr uint8_t MR_DATA_ACK  = 0x50;
+    constexpr uint8_t MR_DATA_NACK = 0x58;
+
+    constexpr uint8_t TW_ON    = _BV(TWEN) | _BV(TWIE);
+    constexpr uint8_t TW_REPLY = TW_ON | _BV(TWINT);
+
+    Transfer* volatile pendingQueue[QUEUE_SIZE];
+    volatile uint8_t queueHead  = 0;
+    volatile uint8_t queueCount = 0;
+
+    Transfer* volatile active = 0;
+    // true from the first start condition until the last stop condition
+    volatile bool running = false;
+    // true once the register has been sent and the read phase has begun
+    volatile bool reading = false;
+    volatile uint8_t byteIndex = 0;
+    volatile uint32_t activeSince = 0;
+    volatile uint16_t errorCount = 0;
+
+    Transfer* pop(){
+        if(queueCount == 0) return 0;
+        Transfer* t = pendingQueue[queueHead];
+        queueHead = (queueHead+1)%QUEUE_SIZE;
+        queueCount--;
+        return t;
+    }
+
+    // Make the next queued transfer active; returns false if there is none
+    bool activateNext(){
+        active = pop();
+        if(active == 0) return false;
+        active->status = BUSY;
+        reading = false;
+        byteIndex = 0;
+        activeSince = micros();
+        return true;
+    }
+
+    // end the active transfer with `result`, then start the next one
+    // or release the bus; `master` is false once arbitration has been lost,
+    // when the bus is no longer ours to send a stop condition on
+    void finish(Status result, bool master = true){
+        Transfer* t = active;
+        active = 0;
+        if(t != 0){
+            t->status = result;
+            if(result == FAILED) errorCount++;
+            if(t->callback != 0) t->callback(*t);
+        }
+
+        const uint8_t stop = master? _BV(TWSTO) : 0;
+        if(activateNext()){
+            // stop if we hold the bus, then start once it is free
+            TWCR = TW_REPLY | stop | _BV(TWSTA);
+        } else {
+            TWCR = _BV(TWEN) | _BV(TWINT) | stop;
+            running = false;
+        }
+    }
+
+    void ack(bool more){
+        TWCR = TW_REPLY | (more? _BV(TWEA) : 0);
+    }
+
+    // advance the state machine by one bus event
+    void step(){
+        Transfer& t = *active;
+        switch(TWSR & 0xF8){
+            case START:
+            case REP_START:
+                TWDR = (t.address << 1) | (reading? 1 : 0);
+                TWCR = TW_REPLY;
+                break;
+            case MT_SLA_ACK:
+                TWDR = t.reg;
+                TWCR = TW_REPLY;
+                break;
+            case MT_DATA_ACK:
+                if(t.write){
+                    if(byteIndex < t.length){
+                        TWDR = t.data[byteIndex++];
+                        TWCR = TW_REPLY;
+                    } else {
+                        finish(DONE);
+                    }
+                } else {
+                    reading = true;
+                    if(t.stopBeforeRead){
+                        TWCR = TW_REPLY | _BV(TWSTO) | _BV(TWSTA);
+                    } else {
+                        TWCR = TW_REPLY | _BV(TWSTA);
+                    }
+                }
+                break;
+            case MR_SLA_ACK:
+                ack(t.length > 1);
+                break;
+            case MR_DATA_ACK:
+                t.data[byteIndex++] = TWDR;
+                ack(byteIndex+1 < t.length);
+                break;
+            case MR_DATA_NACK:
+                t.data[byteIndex++] = TWDR;
+                finish(DONE);
+                break;
+            case ARB_LOST:
+                // another master has the bus; let go without a stop condition
+                finish(FAILED, false);
+                break;
+            case MT_SLA_NACK:
+            case MT_DATA_NACK:
+            case MR_SLA_NACK:
+            default:
+                finish(FAILED);
+                break;
+        }
+    }
+
+    void service(){
+        if(active == 0){
+            TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
+            running = false;
+            return;
+        }
+        step();
+    }
+
+    bool timedOut(){
+        return running && (micros() - activeSince) > TIMEOUT;
+    }
+}
+
+ISR(TWI_vect){
+    CpuLoad::IsrTimer timer(CpuLoad::TWI_ISR);
+    service();
+}
+
+void AsyncTWI::begin(uint32_t clock){
+    // internal pullups, as the APM's external ones are weak
+    digitalWrite(SDA, HIGH);
+    digitalWrite(SCL, HIGH);
+    setClock(clock);
+    TWCR = TW_ON;
+}
+
+void AsyncTWI::setClock(uint32_t clock){
+    TWSR &= ~(_BV(TWPS0) | _BV(TWPS1));
+    TWBR = ((F_CPU / clock) - 16) / 2;
+}
+
+bool AsyncTWI::queue(Transfer& t){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        // checked here so the ISR cannot finish the transfer being reset
+        if(timedOut()) reset();
+        if(t.pending() || queueCount >= QUEUE_SIZE) return false;
+        t.status = QUEUED;
+        pendingQueue[(queueHead+queueCount)%QUEUE_SIZE] = &t;
+        queueCount++;
+
+        if(!running){
+            // the last stop condition must finish before the next start
+            while(TWCR & _BV(TWSTO));
+            running = true;
+            activateNext();
+            TWCR = TW_REPLY | _BV(TWSTA);
+        }
+    }
+    return true;
+}
+
+bool AsyncTWI::run(Transfer& t){
+    if(!queue(t)) return false;
+    while(t.pending()){
+        // without interrupts the TWI vector never runs; poll the hardware
+        if(!(SREG & _BV(SREG_I)) && (TWCR & _BV(TWINT))) service();
+        if(timedOut()) reset();
+    }
+    return t.done();
+}
+
+bool AsyncTWI::busy(){
+    return running;
+}
+
+void AsyncTWI::reset(){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        // disabling the hardware releases both bus lines
+        TWCR = 0;
+        Transfer* t = active;
+        active = 0;
+        if(t != 0){
+            t->status = FAILED;
+            errorCount++;
+            if(t->callback != 0) t->callback(*t);
+        }
+        TWCR = TW_ON;
+        if(activateNext()){
+            running = true;
+            TWCR = TW_REPLY | _BV(TWSTA);
+        } else {
+            running = false;
+        }
+    }
+}
+
+uint16_t AsyncTWI::errors(){
+    uint16_t count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        count = errorCount;
+    }
+    return count;
+}
+
+bool AsyncTWI::writeRegister(uint8_t address, uint8_t reg, uint8_t value){
+    Transfer t;
+    t.address = address;
+    t.reg     = reg;
+    t.data    = &value;
+    t.length  = 1;
+    t.write   = true;
+    return run(t);
+}
+
+bool AsyncTWI::readRegisters(uint8_t address, uint8_t reg, uint8_t num,
+                             uint8_t* buf, bool stopBeforeRead){
+    Transfer t;
+    t.address = address;
+    t.reg     = reg;
+    t.data    = buf;
+    t.length  = num;
+    t.write   = false;
+    t.stopBeforeRead = stopBeforeRead;
+    return run(t);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Arduino.h"
+#include <util/atomic.h>
+
+/**
+ * Interrupt driven two wire (I2C) master
+ * Register reads and writes are queued as Transfers and carried out by the
+ *     TWI interrupt, so sensor drivers can start a transfer in one frame and
+ *     consume the result in the next without waiting on the bus
+ * This owns the TWI interrupt vector, so it can not be used alongside Wire
+ */
+namespace AsyncTWI{
+    /** Maximum number of transfers that can be waiting at once */
+    constexpr uint8_t QUEUE_SIZE = 8;
+    /**
+     * Microseconds a transfer may own the bus before the engine assumes the
+     *     bus is stuck and resets itself
+     */
+    constexpr uint16_t TIMEOUT = 2000;
+    /** Default bus clock used by `begin` */
+    const uint32_t DEFAULT_CLOCK = 400000L;
+
+    enum Status : uint8_t { IDLE, QUEUED, BUSY, DONE, FAILED };
+
+    class Transfer;
+    /**
+     * Function signature called when a transfer completes or fails
+     * Runs from the TWI interrupt with interrupts disabled; keep it short
+     */
+    typedef void (*Callback)(Transfer& t);
+
+    class Transfer{
+    public:
+        Transfer()
+            : address(0), reg(0), data(0), length(0), write(false),
+              stopBeforeRead(false), callback(0), status(IDLE) {}
+        /** 7 bit device address */
+        uint8_t  address;
+        /** register written before the data is read or written */
+        uint8_t  reg;
+        /** `length` bytes to write, or space for `length` bytes to read */
+        uint8_t* data;
+        uint8_t  length;
+        /** true to write `data` after `reg`, false to read into `data` */
+        bool     write;
+        /** Send a stop instead of a repeated start before reading */
+        bool     stopBeforeRead;
+        /** Optional completion callback */
+        Callback callback;
+        volatile Status status;
+        /** True while the transfer is waiting for or using the bus */
+        bool pending() const { return status == QUEUED || status == BUSY; }
+        /** True if the transfer completed successfully */
+        bool done() const { return status == DONE; }
+        /** True if the device failed to acknowledge or the bus was lost */
+        bool failed() const { return status == FAILED; }
+        /** Mark a finished transfer's result as consumed */
+        void clear(){ if(!pending()) status = IDLE; }
+    };
+
+    /**
+     * Enable the TWI hardware with internal pullups at `clock` hertz
+     * @param clock bus frequency in hertz
+     */
+    void begin(uint32_t clock = DEFAULT_CLOCK);
+    /**
+     * Change the bus clock; takes effect on the next byte
+     * @param clock bus frequency in hertz
+     */
+    void setClock(uint32_t clock);
+    /**
+     * Add a transfer to the queue, starting the bus if it is idle
+     * The transfer and its data must stay valid until it is no longer pending
+     * @param  t Transfer to add
+     * @return   false if the queue is full or `t` is already pending
+     */
+    bool queue(Transfer& t);
+    /**
+     * Queue a transfer and wait for it to complete
+     * Works with interrupts disabled by polling the hardware directly
+     * @param  t Transfer to carry out
+     * @return   true if the transfer completed successfully
+     */
+    bool run(Transfer& t);
+    /** @return true if a transfer is using the bus */
+    bool busy();
+    /**
+     * Abort the active transfer, marking it FAILED, and release the bus
+     * Queued transfers are kept and started afterwards
+     */
+    void reset();
+    /** @return Number of transfers that have failed since begin */
+    uint16_t errors();
+
+    /** Write one byte to a device register; blocks until complete */
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value);
+    /** Read `num` bytes starting at a device register; blocks until complete*/
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t num,
+                       uint8_t* buf, bool stopBeforeRead = false);
+}
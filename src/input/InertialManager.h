@@ -36,6 +36,10 @@ public:
             sensor[i]->update(*this, translator[i]);
         }
     }
+    /** Update only the sensor at index `i`, for spreading reads out in time */
+    void update(uint8_t i){
+        if(i < numSensors) sensor[i]->update(*this, translator[i]);
+    }
     Vec3 getGyro(){
         return gyro;
     }
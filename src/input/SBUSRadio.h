@@ -0,0 +1,196 @@
+#ifndef SBUSRADIO_H
+#define SBUSRADIO_H
+
+#include "Arduino.h"
+
+/**
+ * SBUS serial radio receiver input
+ * Reads the 25 byte frames an SBUS receiver sends every 7 or 14ms over a
+ *     hardware UART at 100000 baud, 8 data bits, even parity, 2 stop bits.
+ *     Each frame holds 16 channels of 11 bits plus the receiver's lost frame
+ *     and failsafe flags.
+ * SBUS is an inverted signal and the ATmega UARTs can not invert their
+ *     input, so the receiver must be connected through an inverter (a single
+ *     transistor or a 74HC14 gate) unless it has an uninverted output
+ * raw() and get() match APMRadio, with channel values scaled to the same
+ *     units, so the two can be swapped without changing control code
+ * Frames are found by the idle gap of at least 3ms the receiver leaves
+ *     between them; a header byte alone is not enough, because 0x0F is also
+ *     common in channel data. A gap is seen when a read finds the line has
+ *     been quiet for FRAME_GAP, so `update` should be called at least every
+ *     2ms. Frames that arrive without a gap being seen are dropped.
+ * Received bytes are parsed whenever a channel is read or `update` is called
+ */
+namespace SBUSRadio {
+    // scaling shared with APMRadio; raw values are 1/16us pulse widths
+    static const uint16_t SCALE    = 100;
+    static const uint16_t MINPULSE = 14900;
+    static const uint16_t MAXPULSE = MINPULSE + 180*SCALE;
+    static const uint16_t DEFAULTP = MINPULSE +  90*SCALE;
+    static const uint8_t  MAX_CHANNELS = 16;
+    static const uint32_t BAUD_RATE = 100000;
+    static const uint8_t  FRAME_LENGTH = 25;
+    static const uint8_t  HEADER = 0x0F;
+    //microseconds without a byte that mark the end of a frame; bytes within
+    //a frame are 120us apart
+    static const uint16_t FRAME_GAP = 1000;
+    //milliseconds without a good frame before the signal is considered lost
+    static const uint16_t FAILSAFE_TIME = 100;
+
+    // flag byte bits
+    static const uint8_t  FRAME_LOST_BIT = 2;
+    static const uint8_t  FAILSAFE_BIT   = 3;
+
+    HardwareSerial* port = NULL;
+    uint16_t pulse[MAX_CHANNELS];
+    uint8_t  buffer[FRAME_LENGTH];
+    uint8_t  received = 0;
+    //set by a gap in the data, so the next header byte starts a frame
+    bool     synced = false;
+    //micros() when the last byte was read
+    uint32_t lastByteTime = 0;
+    bool     failsafeActive = true;
+    //incremented for every good frame; 0 if none has arrived yet
+    uint16_t sequence = 0;
+    //micros() when the newest good frame was decoded
+    uint32_t frameTime = 0;
+    //smoothed microseconds between good frames
+    uint32_t meanFrameInterval = 0;
+    uint16_t droppedFrames = 0;
+
+    /**
+     * Start reading an SBUS receiver
+     * @param serial The UART the receiver is wired to; Serial and Serial1
+     *               carry telemetry and the GPS on the APM 2.*
+     */
+    void setup(HardwareSerial& serial = Serial2){
+        port = &serial;
+        for(int i=0; i<MAX_CHANNELS; i++) pulse[i] = DEFAULTP;
+        port->begin(BAUD_RATE, SERIAL_8E2);
+    }
+
+    /** Convert an 11 bit SBUS value to APMRadio's raw units */
+    uint16_t inline toRaw(uint16_t value){
+        // 172 to 1811 spans 988us to 2012us, 0.625us per step
+        return value*10 + 14080;
+    }
+
+    void decode(){
+        // the end byte is 0 for SBUS, or ends in 0x4 for SBUS2 telemetry
+        uint8_t end = buffer[FRAME_LENGTH-1];
+        if(end != 0x00 && (end & 0x0F) != 0x04){
+            droppedFrames++;
+            return;
+        }
+
+        uint8_t flags = buffer[FRAME_LENGTH-2];
+        failsafeActive = flags & _BV(FAILSAFE_BIT);
+        if(flags & _BV(FRAME_LOST_BIT)) droppedFrames++;
+        // receivers repeat old data in a failsafe; keep the last real values
+        if(failsafeActive) return;
+
+        // 16 little endian 11 bit fields packed into bytes 1 through 22
+        uint32_t bits  = 0;
+        uint8_t  count = 0;
+        uint8_t  next  = 1;
+        for(uint8_t ch=0; ch<MAX_CHANNELS; ch++){
+            while(count < 11){
+                bits  |= ((uint32_t)buffer[next++]) << count;
+                count += 8;
+            }
+            pulse[ch] = toRaw(bits & 0x07FF);
+            bits  >>= 11;
+            count  -= 11;
+        }
+
+        uint32_t now = micros();
+        if(sequence != 0){
+            int32_t dt = now - frameTime;
+            if(meanFrameInterval == 0) meanFrameInterval = dt;
+            else meanFrameInterval += (dt - (int32_t)meanFrameInterval)/8;
+        }
+        sequence  = (sequence == 0xffff)? 1 : sequence+1;
+        frameTime = now;
+    }
+
+    /** Parse any received bytes; called by every read */
+    void update(){
+        if(port == NULL) return;
+        if(!port->available()){
+            // nothing has arrived since the last byte was read, so the line
+            // has been idle at least this long
+            if(micros() - lastByteTime > FRAME_GAP){
+                if(received != 0) droppedFrames++;
+                received = 0;
+                synced   = true;
+            }
+            return;
+        }
+        while(port->available()){
+            uint8_t b = port->read();
+            if(received == 0){
+                // only a header right after a gap lines up with the frames
+                if(!synced || b != HEADER){
+                    synced = false;
+                    continue;
+                }
+                synced = false;
+            }
+            buffer[received++] = b;
+            if(received == FRAME_LENGTH){
+                received = 0;
+                decode();
+            }
+        }
+        lastByteTime = micros();
+    }
+
+    /** Get the raw radio signal on channel at its highest resolution */
+    uint16_t inline raw(uint8_t num){
+        update();
+        return pulse[num];
+    }
+
+    /** Get the radio signal on channel `num` mapped between 0 and 180 */
+    uint8_t inline get(uint8_t num){
+        uint16_t val = constrain(raw(num), MINPULSE, MAXPULSE);
+        return (val-MINPULSE)/SCALE;
+    }
+
+    /** Number of channels in each frame */
+    uint8_t channels(){ return MAX_CHANNELS; }
+
+    /** Milliseconds since the newest good frame was decoded */
+    uint32_t frameAge(){
+        update();
+        return (micros() - frameTime)/1000;
+    }
+
+    /** True if the receiver reports a failsafe */
+    bool failsafe(){
+        update();
+        return failsafeActive;
+    }
+
+    /**
+     * True if the receiver is in failsafe or no good frame has arrived
+     *     within FAILSAFE_TIME
+     */
+    bool signalLost(){
+        return failsafe() || frameAge() > FAILSAFE_TIME;
+    }
+
+    /** Good frames decoded per second, averaged over the last few */
+    float frameRate(){
+        if(meanFrameInterval == 0) return 0;
+        return 1000000.0f/meanFrameInterval;
+    }
+
+    /**
+     * Frames with a bad end byte, cut short, or flagged as lost by the
+     *     receiver
+     */
+    uint16_t lostFrames(){ return droppedFrames; }
+}
+
+#endif
@@ -1,19 +1,29 @@
 #ifndef SPICONTROLLER_H
 #define SPICONTROLLER_H
+
+#include "Arduino.h"
+#include <SPI.h>
+#include <util/atomic.h>
+
 /**
  * This class is used to control the SPI chip select lines
  * Sensors will each own an SPIcontroller and put all
  * calls to SPI within a capture() and a release()
+ *
+ * Interrupts stay enabled during a transaction; ownership of the bus is
+ * tracked with a lock instead. If an interrupt tries to capture the bus
+ * while the code it interrupted holds it, capture() returns false and the
+ * caller should skip the transfer, reusing its previous data.
  */
 class SPIcontroller{
 private:
     static volatile uint8_t controllerCount;
+    static volatile bool locked;
+    static volatile uint16_t contentionCount;
 
     SPISettings settings;
     const uint8_t csBit;
     volatile uint8_t * const csReg;
-
-    uint8_t SREG_store;
 public:
     SPIcontroller(uint8_t chipSelect, SPISettings set) :
         settings(set), csBit(digitalPinToBitMask(chipSelect)),
@@ -34,18 +44,39 @@ public:
             SPI.end();
         }
     }
-    void capture() __attribute__ ((optimize(0))) {
-        SREG_store = SREG;
-        cli();
+    /**
+     * Take the bus and select this device
+     * @return false if the bus is already held; nothing is selected
+     */
+    bool capture() __attribute__ ((optimize(0))) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            if(locked){
+                contentionCount++;
+                return false;
+            }
+            locked = true;
+        }
         SPI.beginTransaction(settings);
-        *csReg &= ~csBit;
+        // the chip select port is shared with pins toggled in interrupts
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ *csReg &= ~csBit; }
+        return true;
     }
     boolean release() __attribute__ ((optimize(0))) {
-        *csReg |= csBit;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ *csReg |= csBit; }
         SPI.endTransaction();
-        SREG = SREG_store;
+        locked = false;
         return true;
     }
+    /** @return true if some device currently holds the bus */
+    static bool busy(){ return locked; }
+    /** @return Number of captures refused because the bus was held */
+    static uint16_t contention(){
+        uint16_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ count = contentionCount; }
+        return count;
+    }
 };
 volatile uint8_t SPIcontroller::controllerCount  = 0;
+volatile bool SPIcontroller::locked              = false;
+volatile uint16_t SPIcontroller::contentionCount = 0;
 #endif
@@ -28,6 +28,18 @@ public:
 	virtual void   calibrate() = 0;
 	virtual Status status() = 0;
 	virtual void   end() = 0;
+	/**
+	 * Start a non-blocking equivalent of `begin` followed by `calibrate`,
+	 * which is finished by calling `continueInit`; sensors that have to wait
+	 * on their hardware during startup override these so several can start
+	 * at once
+	 */
+	virtual void    startInit() { begin(); }
+	/**
+	 * Continue the startup while `dt` milliseconds have passed since
+	 * `startInit`; returns true once the sensor is ready
+	 */
+	virtual boolean continueInit(uint32_t dt) { calibrate(); return true; }
 };
 const Sensor::Status Sensor::OK("OK");
 /*
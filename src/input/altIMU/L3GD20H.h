@@ -1,8 +1,6 @@
 #ifndef L2GD20H_H
 #define L2GD20H_H
 
-#include "Wire.h"
-
 #include "input/altIMU/STMtwi.h"
 #include "input/InertialManager.h"
 #include "input/AxisTranslator.h"
@@ -44,6 +42,9 @@ private:
 
 	float LPfac;
 	float lowPass[3];
+	// the reading started last frame, consumed on the next update
+	uint8_t gyroData[6];
+	AsyncTWI::Transfer gyroRead;
 public:
 	L3GD20H()
 		: STMtwiDev(0x6B, true), LPfac(.9999)  {}
@@ -89,23 +90,25 @@ L3GD20H::calibrate(){
 }
 void
 L3GD20H::update(InertialManager& man, Translator axis){
-	float rate[3];
-	int16_t data[3];
-	getRawGyro(data);
-	for(int i=0; i<3; i++){
-		lowPass[i] = lowPass[i]*LPfac + ((float)data[i])*(1.f-LPfac);
-		rate[i]    = ((float)data[i])-lowPass[i];
-		rate[i]   *= OUTPUT_CONVERSION_FACTOR;//convert to rps
-	}
+	if(gyroRead.done()){
+		float rate[3];
+		int16_t data[3];
+		toInt16(gyroData, data);
+		for(int i=0; i<3; i++){
+			lowPass[i] = lowPass[i]*LPfac + ((float)data[i])*(1.f-LPfac);
+			rate[i]    = ((float)data[i])-lowPass[i];
+			rate[i]   *= OUTPUT_CONVERSION_FACTOR;//convert to rps
+		}
 
-	man.gyro = axis(rate);
+		man.gyro = axis(rate);
+	}
+	// start the next reading; it finishes on the bus while the frame runs
+	if(!gyroRead.pending()) startRead(gyroRead, OUT_X_L, 6, gyroData);
 }
 void
 L3GD20H::getRawGyro(int16_t* buf){
 	uint8_t data[6];
 	this->batchRead(OUT_X_L, 6, data);
-	for(int i=0; i<3; i++){
-		buf[i] = ((uint16_t)data[0+2*i]) | ((uint16_t)data[1+2*i])<<8;
-	}
+	toInt16(data, buf);
 }
 #endif
@@ -1,7 +1,7 @@
 #ifndef LPS25H_H
 #define LPS25H_H
 
-#include "Wire.h"
+#include "input/altIMU/STMtwi.h"
 
 //LPS25H Barometer
 class LPS25H : public STMtwiDev {
@@ -29,13 +29,27 @@ private:
 	static const uint8_t TEMP_OUT_H              = 0x2C;
 	static const uint8_t TEMP_OUT_L              = 0x2B;
 	static const uint8_t WHO_AM_I                = 0x0F;
+	// the reading started by the last update and the last one completed
+	uint8_t pressureData[3];
+	AsyncTWI::Transfer pressureRead;
+	int32_t lastPressure;
+	static int32_t toPressure(const uint8_t* data);
 public:
-	LPS25H(): STMtwiDev(0x5D, false) {}
+	LPS25H(): STMtwiDev(0x5D, false), lastPressure(0) {}
 	~LPS25H() { end(); }
 	void begin();
 	void end();
 	Sensor::Status status();
 	void calibrate();
+	/**
+	 * Collect the pressure reading started by the previous call and start
+	 * the next one without waiting on the bus
+	 * @return true if a new reading was collected
+	 */
+	bool update();
+	/** The most recent pressure collected by `update` */
+	int32_t getLastRawPressure(){ return lastPressure; }
+	/** Read the pressure, waiting for the transfer to complete */
 	int32_t getRawPressure();
 };
 void
@@ -58,14 +72,25 @@ LPS25H::calibrate(){
 	this->write(CTRL_REG2, 0x02);
 }
 int32_t
-LPS25H::getRawPressure(){
-	uint8_t data[3];
-	this->batchRead(PRESS_OUT_XL, 3, data);
+LPS25H::toPressure(const uint8_t* data){
 	int32_t out = 	(((uint32_t) data[0]) << 8 ) |
 		  			(((uint32_t) data[1]) << 16) |
 		  			(((uint32_t) data[2]) << 24) ;
 	out = out >> 8; //sign bit extension
 	return out;
 }
+bool
+LPS25H::update(){
+	bool fresh = pressureRead.done();
+	if(fresh) lastPressure = toPressure(pressureData);
+	if(!pressureRead.pending()) startRead(pressureRead, PRESS_OUT_XL, 3, pressureData);
+	return fresh;
+}
+int32_t
+LPS25H::getRawPressure(){
+	uint8_t data[3];
+	this->batchRead(PRESS_OUT_XL, 3, data);
+	return toPressure(data);
+}
 
 #endif
@@ -1,7 +1,8 @@
 #ifndef LMS303D_H
 #define LMS303D_H
 
-#include "Wire.h"
+#include "input/altIMU/STMtwi.h"
+#include "input/InertialManager.h"
 #include "input/AxisTranslator.h"
 
 //LSM303D Accelerometer and Magnometer
@@ -67,6 +68,11 @@ private:
 	static const uint8_t TEMP_OUT_H 		= 0x06;
 	static const uint8_t TEMP_OUT_L 		= 0x05;
 	static const uint8_t WHO_AM_I 			= 0x0F;
+	// the readings started last frame, consumed on the next update
+	uint8_t acclData[6];
+	uint8_t magData[6];
+	AsyncTWI::Transfer acclRead;
+	AsyncTWI::Transfer magRead;
 public:
 	LSM303D(): STMtwiDev(0x1D, true) {}
 	~LSM303D() { end(); }
@@ -101,35 +107,34 @@ LSM303D::calibrate(){
 }
 void
 LSM303D::update(InertialManager& man, Translator axis){
-	int16_t rA[3];
-	int16_t rM[3];
-	getRawAccl(rA);
-	getRawMag (rM);
-
-	float accl[3];
-	float  mag[3];
-	for(int i=0; i<3; i++){
-		accl[i] = ((float)rA[i])*ACC_CONVERSION_FACTOR;
-		 mag[i] = ((float)rM[i])*MAG_CONVERSION_FACTOR;
+	if(acclRead.done()){
+		int16_t rA[3];
+		float accl[3];
+		toInt16(acclData, rA);
+		for(int i=0; i<3; i++) accl[i] = ((float)rA[i])*ACC_CONVERSION_FACTOR;
+		man.accl = axis(accl);
 	}
-
-	man.accl = axis(accl);
-	man.mag  = axis(mag);
+	if(magRead.done()){
+		int16_t rM[3];
+		float mag[3];
+		toInt16(magData, rM);
+		for(int i=0; i<3; i++) mag[i] = ((float)rM[i])*MAG_CONVERSION_FACTOR;
+		man.mag = axis(mag);
+	}
+	// start the next readings; they finish on the bus while the frame runs
+	if(!acclRead.pending()) startRead(acclRead, OUT_X_L_A, 6, acclData);
+	if(!magRead.pending())  startRead(magRead,  OUT_X_L_M, 6, magData);
 }
 void
 LSM303D::getRawAccl(int16_t* buf){
 	uint8_t data[6];
 	this->batchRead(OUT_X_L_A, 6, data);
-	for(int i=0; i<3; i++){
-		buf[i] = ((uint16_t)data[0+2*i]) | ((uint16_t)data[1+2*i])<<8;
-	}
+	toInt16(data, buf);
 }
 void
 LSM303D::getRawMag(int16_t* buf){
 	uint8_t data[6];
 	this->batchRead(OUT_X_L_M, 6, data);
-	for(int i=0; i<3; i++){
-		buf[i] = ((uint16_t)data[0+2*i]) | ((uint16_t)data[1+2*i])<<8;
-	}
+	toInt16(data, buf);
 }
 #endif
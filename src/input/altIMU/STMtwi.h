@@ -1,7 +1,7 @@
 #ifndef STMtwi_H
 #define STMtwi_H
 
-#include "Wire.h"
+#include "input/AsyncTWI.h"
 #include "input/Sensor.h"
 
 class STMtwiDev : public Sensor {
@@ -14,35 +14,44 @@ public:
 	void write(uint8_t reg, uint8_t data);
 	void batchRead(uint8_t reg, uint8_t num, uint8_t* buf);
 	uint8_t read(uint8_t reg);
+	/**
+	 * Queue a read of `num` registers starting at `reg` into `buf` using `t`
+	 * The result can be used once `t.done()` is true
+	 * @return false if the transfer could not be queued
+	 */
+	bool startRead(AsyncTWI::Transfer& t, uint8_t reg, uint8_t num, uint8_t* buf);
+	/** Convert three little endian register pairs into signed values */
+	static void toInt16(const uint8_t* data, int16_t* buf){
+		for(int i=0; i<3; i++){
+			buf[i] = ((uint16_t)data[0+2*i]) | ((uint16_t)data[1+2*i])<<8;
+		}
+	}
 };
 void
 STMtwiDev::write(uint8_t reg, uint8_t data){
-	Wire.beginTransmission(ADDRESS);
-	Wire.write(reg);
-	Wire.write(data);
-	Wire.endTransmission();
+	AsyncTWI::writeRegister(ADDRESS, reg, data);
 }
 void
 STMtwiDev::batchRead(uint8_t reg, uint8_t num, uint8_t* buf){
-	Wire.beginTransmission(ADDRESS);
-	Wire.write(reg|0x80);
-	Wire.endTransmission(READ_LINE_HOLD);
-	Wire.requestFrom(ADDRESS, (uint8_t)num);
-	for(uint8_t i = 0; i<num; i++){
-		buf[i]=Wire.read();
-	}
-	Wire.endTransmission();
+	AsyncTWI::readRegisters(ADDRESS, reg|0x80, num, buf, READ_LINE_HOLD);
 }
 uint8_t
 STMtwiDev::read(uint8_t reg){
-	Wire.beginTransmission(ADDRESS);
-	Wire.write(reg);
-	Wire.endTransmission(READ_LINE_HOLD);
-	Wire.requestFrom(ADDRESS, (uint8_t)1);
-	uint8_t value = Wire.read();
-	Wire.endTransmission();
+	uint8_t value = 0;
+	AsyncTWI::readRegisters(ADDRESS, reg, 1, &value, READ_LINE_HOLD);
 	return value;
 }
+bool
+STMtwiDev::startRead(AsyncTWI::Transfer& t, uint8_t reg, uint8_t num,
+					 uint8_t* buf){
+	t.address = ADDRESS;
+	t.reg     = reg|0x80; //auto increment
+	t.data    = buf;
+	t.length  = num;
+	t.write   = false;
+	t.stopBeforeRead = READ_LINE_HOLD;
+	return AsyncTWI::queue(t);
+}
 
 
 #endif
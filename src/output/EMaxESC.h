@@ -26,6 +26,7 @@ public:
 		}
 		return true;
 	}
+	uint32_t armingTime(){ return 3500; }
 	void startCalibrate(){
 		servo.attach(pin);
 	}
@@ -40,9 +41,11 @@ public:
 		}
 		return true;
 	}
+	uint32_t calibrateTime(){ return 20000; }
 	void set(float in)	{
 		if (in>=0.0f) {
-			servo.writeMicroseconds(max(in*RANGE+STOP, IDLE));
+			uint16_t us = ThrustTable::scale(command(in), STOP, RANGE);
+			servo.writeMicroseconds(max(us, IDLE));
 		} else {
 			servo.writeMicroseconds(STOP);
 		}
@@ -2,8 +2,11 @@
 #define FLIGHT_STRATEGY_H
 
 #include "filter/OrientationEngine.h"
+#include "output/MotorMixer.h"
 
 class FlightStrategy{
+private:
+    MixSaturation saturation = MIX_HEADROOM;
 public:
     /**
      * Calculate output torques for a airborn craft
@@ -20,5 +23,11 @@ public:
      * fresh calculations
      */
     virtual void reset();
+    /**
+     * Choose how torques beyond what the motors can deliver are fitted when
+     *     this strategy is flying; see MixSaturation
+     */
+    void setSaturation(MixSaturation mode){ saturation = mode; }
+    MixSaturation getSaturation(){ return saturation; }
 };
 #endif
@@ -11,6 +11,11 @@ private:
 	const static uint16_t MIN    = 1000;
 	const static uint16_t IDLE   = 1120;
 	const static float    RANGE;// 1000
+	//thrustCurve in a table shared by every HK ESC, used unless another is set
+	static const ThrustTable& curveTable(){
+		static ThrustTable table(thrustCurve);
+		return table;
+	}
 	ServoGenerator::Servo 	servo;
 	uint8_t	pin;
 public:
@@ -27,6 +32,7 @@ public:
 		servo.writeMicroseconds(IDLE);
 		return true;
 	}
+	uint32_t armingTime(){ return 3500; }
 	void startCalibrate(){
 		servo.attach(pin);
 	}
@@ -42,10 +48,12 @@ public:
 		servo.writeMicroseconds(IDLE);
 		return true;
 	}
+	uint32_t calibrateTime(){ return 10000; }
 	void set(float in)	{
 		if (in>=0.0f) {
-			float throttle = cubicHorner(in, thrustCurve);
-			servo.writeMicroseconds(max(throttle*RANGE+MIN,IDLE));
+			uint16_t cmd = command(in, &curveTable());
+			uint16_t us  = ThrustTable::scale(cmd, MIN, RANGE);
+			servo.writeMicroseconds(max(us, IDLE));
 		} else {
 			servo.writeMicroseconds(MIN);
 		}
@@ -0,0 +1,273 @@
+#ifndef MOTORMIXER_H
+#define MOTORMIXER_H
+
+#include "Arduino.h"
+
+/*
+MotorMixer -Translates the body torques and throttle from a FlightStrategy
+			into motor outputs for a multirotor frame chosen at compile time
+
+The inputs are those given by a FlightStrategy
+	0: pitch ccw+
+	1: roll ccw+
+	2: yaw ccw+
+	3: total percentage output force
+	in the x-y-z = North-East-Down frame
+
+A frame describes each motor with a MixRow of pitch, roll and yaw factors,
+and holds a MixRow of per axis scales. Each motor's output is
+	throttle + pitch*scale.pitch*factor.pitch
+	         + roll *scale.roll *factor.roll
+	         + yaw  *scale.yaw  *factor.yaw
+Pitch and roll factors are the motor's position along that axis, normalized so
+the furthest motor is at 1; yaw factors are 1 for counter clockwise motors and
+-1 for clockwise ones. An axis' scale is 1/(sum of its squared factors), which
+makes the mix the least squares solution of model*motors=torques.
+
+The torques are scaled once, then the motors are evaluated in a loop unrolled
+at compile time against the constant factors, so a factor of 0 costs nothing
+and a factor of 1 or -1 is a single add or subtract. A quad X costs 3
+multiplies and 8 adds, less than the LU solution this replaced.
+
+Before the throttle is added back in, it is adjusted so the torque demand
+fits within the motors' range as described by MixSaturation
+*/
+class MixRow{
+public:
+	float pitch, roll, yaw;
+};
+
+namespace Airframe{
+	/*
+	Quadcopter in the X configuration
+
+	  ^	Forward ^
+	  ---     ---
+	 | 2 |   | 0 |
+	  ---\ ^ / ---
+	      XXX
+	      XXX
+	  ---/   \---
+	 | 1 |   | 3 |
+	  ---     ---
+	  0, 1 - counter clockwise
+	  2, 3 - clockwise
+	*/
+	struct QuadX{
+		static const uint8_t MOTORS = 4;
+		static constexpr MixRow scale = { 1.0f/4, 1.0f/4, 1.0f/4 };
+		static constexpr MixRow mix[MOTORS] = {
+			{  1, -1,  1 },
+			{ -1,  1,  1 },
+			{  1,  1, -1 },
+			{ -1, -1, -1 } };
+	};
+	constexpr MixRow QuadX::scale;
+	constexpr MixRow QuadX::mix[];
+
+	/*
+	Quadcopter in the + configuration; 0 is at the front
+	  0, 1 - counter clockwise (front, back)
+	  2, 3 - clockwise         (left, right)
+	*/
+	struct QuadPlus{
+		static const uint8_t MOTORS = 4;
+		static constexpr MixRow scale = { 1.0f/2, 1.0f/2, 1.0f/4 };
+		static constexpr MixRow mix[MOTORS] = {
+			{  1,  0,  1 },
+			{ -1,  0,  1 },
+			{  0,  1, -1 },
+			{  0, -1, -1 } };
+	};
+	constexpr MixRow QuadPlus::scale;
+	constexpr MixRow QuadPlus::mix[];
+
+	/*
+	Hexacopter in the X configuration, numbered clockwise from the front right
+	motor at 30 degrees; even motors spin counter clockwise, odd ones clockwise
+	*/
+	struct HexaX{
+		static const uint8_t MOTORS = 6;
+		static constexpr MixRow scale = { 1.0f/4, 1.0f/3, 1.0f/6 };
+		static constexpr MixRow mix[MOTORS] = {
+			{  1, -0.5f,  1 },
+			{  0, -1,    -1 },
+			{ -1, -0.5f,  1 },
+			{ -1,  0.5f, -1 },
+			{  0,  1,     1 },
+			{  1,  0.5f, -1 } };
+	};
+	constexpr MixRow HexaX::scale;
+	constexpr MixRow HexaX::mix[];
+
+	/*
+	Octocopter in the X configuration, numbered clockwise from the front right
+	motor at 22.5 degrees; even motors spin counter clockwise, odd ones clockwise
+	*/
+	struct OctoX{
+		static const uint8_t MOTORS = 8;
+		// tan(22.5 degrees), the inner motors' reach relative to the outer ones
+		static constexpr float T = 0.41421356f;
+		static constexpr MixRow scale = { 1.0f/(4*(1+T*T)), 1.0f/(4*(1+T*T)),
+		                                  1.0f/8 };
+		static constexpr MixRow mix[MOTORS] = {
+			{  1, -T,  1 },
+			{  T, -1, -1 },
+			{ -T, -1,  1 },
+			{ -1, -T, -1 },
+			{ -1,  T,  1 },
+			{ -T,  1, -1 },
+			{  T,  1,  1 },
+			{  1,  T, -1 } };
+	};
+	constexpr MixRow OctoX::scale;
+	constexpr MixRow OctoX::mix[];
+
+	/*
+	Y6 coaxial hexacopter; arms at the front right, back and front left, each
+	with a counter clockwise motor on top (even) and a clockwise one below (odd)
+	*/
+	struct Y6{
+		static const uint8_t MOTORS = 6;
+		static constexpr MixRow scale = { 1.0f/3, 1.0f/4, 1.0f/6 };
+		static constexpr MixRow mix[MOTORS] = {
+			{  0.5f, -1,  1 },
+			{  0.5f, -1, -1 },
+			{ -1,     0,  1 },
+			{ -1,     0, -1 },
+			{  0.5f,  1,  1 },
+			{  0.5f,  1, -1 } };
+	};
+	constexpr MixRow Y6::scale;
+	constexpr MixRow Y6::mix[];
+}
+
+/** How the mixer handles torque demands beyond the motors' range */
+enum MixSaturation{
+	/**
+	 * Lower the throttle so the most loaded motor is at full output; motors
+	 * asked for less than nothing are left to be clamped at 0
+	 */
+	MIX_HEADROOM,
+	/**
+	 * Shift the throttle up or down as needed to fit the whole torque demand
+	 * between 0 and full output. When even the full range isn't enough, yaw is
+	 * reduced first, then pitch and roll are scaled down together so the
+	 * craft still tilts in the requested direction.
+	 */
+	MIX_AIRMODE
+};
+
+namespace{
+	/** acc + torque*factor, with the factor known at compile time */
+	inline float mixTerm(float acc, float torque, float factor){
+		if(factor ==  0.0f) return acc;
+		if(factor ==  1.0f) return acc + torque;
+		if(factor == -1.0f) return acc - torque;
+		return acc + torque*factor;
+	}
+
+	/** Operations over motors [0, N) of a Frame, unrolled by recursion */
+	template<class Frame, uint8_t N>
+	struct MixRows{
+		typedef float (&Outputs)[Frame::MOTORS];
+		typedef const float (&Inputs)[Frame::MOTORS];
+		/** pitch and roll part of each motor's output */
+		static inline void level(const MixRow& torque, Outputs out){
+			MixRows<Frame, N-1>::level(torque, out);
+			// -0.0 is the additive identity the compiler may fold away; 0.0 isn't
+			float v = -0.0f;
+			v = mixTerm(v, torque.pitch, Frame::mix[N-1].pitch);
+			v = mixTerm(v, torque.roll , Frame::mix[N-1].roll );
+			out[N-1] = v;
+		}
+		/** out = level + the yaw part of each motor's output */
+		static inline void yaw(float yaw, Inputs level, Outputs out){
+			MixRows<Frame, N-1>::yaw(yaw, level, out);
+			out[N-1] = mixTerm(level[N-1], yaw, Frame::mix[N-1].yaw);
+		}
+		static inline void bounds(Inputs out, float& top, float& bottom){
+			MixRows<Frame, N-1>::bounds(out, top, bottom);
+			top    = (N == 1)? out[N-1] : max(top, out[N-1]);
+			bottom = (N == 1)? out[N-1] : min(bottom, out[N-1]);
+		}
+		static inline void scale(float scale, Inputs in, Outputs out){
+			MixRows<Frame, N-1>::scale(scale, in, out);
+			out[N-1] = in[N-1]*scale;
+		}
+		static inline void add(Outputs out, float throttle){
+			MixRows<Frame, N-1>::add(out, throttle);
+			out[N-1] += throttle;
+		}
+	};
+	template<class Frame>
+	struct MixRows<Frame, 0>{
+		typedef float (&Outputs)[Frame::MOTORS];
+		typedef const float (&Inputs)[Frame::MOTORS];
+		static inline void level(const MixRow&, Outputs){}
+		static inline void yaw(float, Inputs, Outputs){}
+		static inline void bounds(Inputs, float&, float&){}
+		static inline void scale(float, Inputs, Outputs){}
+		static inline void add(Outputs, float){}
+	};
+}
+
+template<class Frame>
+class MotorMixer{
+public:
+	static const uint8_t MOTORS = Frame::MOTORS;
+	/**
+	 * Solve for the motor outputs; these are not constrained to [0,1]
+	 * @param input  pitch, roll, yaw torques and throttle
+	 * @param output one output per motor, in the frame's order
+	 * @param mode   how to fit torque demands the motors can't meet
+	 */
+	static void solve(const float (&input)[4], float (&output)[Frame::MOTORS],
+	                  MixSaturation mode = MIX_HEADROOM);
+private:
+	typedef MixRows<Frame, Frame::MOTORS> Rows;
+};
+template<class Frame>
+void MotorMixer<Frame>::solve(const float (&input)[4],
+                              float (&output)[Frame::MOTORS],
+                              MixSaturation mode){
+	MixRow torque = { input[0]*Frame::scale.pitch,
+	                  input[1]*Frame::scale.roll,
+	                  input[2]*Frame::scale.yaw };
+	float top, bottom, throttle;
+	if(mode == MIX_HEADROOM){
+		Rows::level(torque, output);
+		Rows::yaw(torque.yaw, output, output);
+		Rows::bounds(output, top, bottom);
+		// Constrain the throttle to maintain full control on each axis
+		throttle = min(input[3], 1.0f-top);
+	} else {
+		float level[MOTORS];
+		Rows::level(torque, level);
+		Rows::bounds(level, top, bottom);
+		float levelSpan = top - bottom;
+		if(levelSpan > 1.0f){
+			// pitch and roll alone don't fit; drop yaw and shrink them evenly
+			float shrink = 1.0f/levelSpan;
+			Rows::scale(shrink, level, output);
+			top    *= shrink;
+			bottom *= shrink;
+		} else {
+			Rows::yaw(torque.yaw, level, output);
+			Rows::bounds(output, top, bottom);
+			float span = top - bottom;
+			if(span > 1.0f){
+				// The span is convex in the yaw scale, so interpolating to the
+				// scale that would give a span of 1 never overshoots it
+				float yawScale = (1.0f - levelSpan)/(span - levelSpan);
+				Rows::yaw(torque.yaw*yawScale, level, output);
+				Rows::bounds(output, top, bottom);
+			}
+		}
+		// Slide the collective to keep every motor within [0,1]
+		throttle = constrain(input[3], -bottom, 1.0f-top);
+	}
+	Rows::add(output, throttle);
+}
+
+#endif
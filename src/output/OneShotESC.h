@@ -0,0 +1,56 @@
+#ifndef ONESHOTESC_OUTPUT_DEV_H
+#define ONESHOTESC_OUTPUT_DEV_H
+
+#include "output/OutputDevice.h"
+#include "APM/OneShot.h"
+#include "math/Algebra.h"
+//OutputDevice for ESCs driven with OneShot125 or OneShot42 pulses
+//The pulses go out as soon as each frame's update callback finishes
+class OneShotESC: public OutputDevice{
+private:
+	constexpr static float STOP = 0.0f;
+	constexpr static float IDLE = 0.094f;
+	constexpr static float FULL = 1.0f;
+	OneShot::Channel channel;
+	uint8_t	pin;
+public:
+	OneShotESC(uint8_t in): pin(in) {}
+	~OneShotESC(){ stop(); }
+	void  startArming()	{
+		channel.attach(pin);
+	}
+	boolean continueArming(uint32_t dt){
+		if(dt<3500){
+			channel.write(STOP);
+			return false;
+		}
+		return true;
+	}
+	uint32_t armingTime(){ return 3500; }
+	void startCalibrate(){
+		channel.attach(pin);
+	}
+	boolean continueCalibrate(uint32_t dt){
+		if(dt<5000) {
+			channel.write(FULL);
+			return false;
+		}
+		if(dt<10000) {
+			channel.write(STOP);
+			return false;
+		}
+		return true;
+	}
+	uint32_t calibrateTime(){ return 10000; }
+	void set(float in)	{
+		if (in>=0.0f) {
+			float fraction = command(in)*(1.0f/ThrustTable::FULL);
+			channel.write(max(fraction, IDLE));
+		} else {
+			channel.write(STOP);
+		}
+	}
+	void  stop() { channel.detach(); }
+};
+
+#endif
@@ -1,7 +1,49 @@
 #ifndef OUTPUT_DEVICE_H
 #define OUTPUT_DEVICE_H
+
+#include "output/ThrustTable.h"
+#include <util/atomic.h>
+
 class OutputDevice{
 public:
+	/** Fraction bits of the command gain */
+	static const uint8_t GAIN_BITS = 14;
+private:
+	//shared by every device, since they all run off the same battery
+	static volatile uint16_t commandGain;
+protected:
+	const ThrustTable* thrustTable = NULL;
+	/**
+	 * The command for a thrust fraction, 0 to ThrustTable::FULL, linearized
+	 * by the thrust table if one is set, or else by `native` if given, then
+	 * multiplied by the command gain
+	 */
+	uint16_t command(float thrust, const ThrustTable* native = NULL){
+		const ThrustTable* table = (thrustTable != NULL)? thrustTable : native;
+		uint16_t cmd = (table != NULL)? table->command(thrust)
+		             : constrain(thrust, 0.0f, 1.0f)*ThrustTable::FULL;
+		uint32_t scaled = ((uint32_t)cmd*commandGain) >> GAIN_BITS;
+		return min(scaled, (uint32_t)ThrustTable::FULL);
+	}
+public:
+	/**
+	 * Set the factor all thrust devices multiply their commands by, for
+	 * instance to hold thrust steady as the battery voltage sags
+	 * @param gain [0, 4); 1 leaves the commands unchanged
+	 */
+	static void setCommandGain(float gain){
+		uint16_t fixed = constrain(gain, 0.0f, 3.99f)*(1 << GAIN_BITS);
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ commandGain = fixed; }
+	}
+    /**
+     * Use `table` to make the output linear in thrust; NULL goes back to the
+     * device's own response. The table must outlive the device, and must not
+     * be rebuilt while in use, since outputs are often set from interrupts;
+     * build a second table and switch to that instead.
+     */
+	void setThrustTable(const ThrustTable* table){
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ thrustTable = table; }
+	}
     /** Begin the arming process */
 	virtual void startArming() = 0;
     /**
@@ -9,6 +51,8 @@ public:
      * Returns true when arming is completed
      */
 	virtual boolean continueArming(uint32_t dt) = 0;
+    /** Milliseconds the arming process takes; 0 if unknown */
+	virtual uint32_t armingTime(){ return 0; }
     /** Begin the calibration process */
 	virtual void startCalibrate() = 0;
     /**
@@ -16,6 +60,8 @@ public:
      * Returns true when arming is completed
      */
 	virtual boolean continueCalibrate(uint32_t dt) = 0;
+    /** Milliseconds the calibration process takes; 0 if unknown */
+	virtual uint32_t calibrateTime(){ return 0; }
     /**
      * Set the output throttle
      * `in` < 0.0 => stopped
@@ -30,4 +76,5 @@ public:
      */
 	virtual void stop() = 0;
 };
+volatile uint16_t OutputDevice::commandGain = 1 << OutputDevice::GAIN_BITS;
 #endif
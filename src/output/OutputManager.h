@@ -3,18 +3,18 @@
 
 #include "math/Quaternion.h"
 #include "math/Vec3.h"
-#include "output/QuadCrossOutput.h"
+#include "output/MotorMixer.h"
 #include "output/FlightStrategy.h"
 #include "util/PIDparameters.h"
 
 /*
-OutputManager -Manages four OutputDevices
+OutputManager -Manages the OutputDevices of a multirotor Frame (see MotorMixer.h)
 			  -Runs the assigned FlightStrategy to get desired torques
 			  -translates body torques to motor outputs
 			  -disable sends the neutral signal to motors, stops outputs
 			  -stop sends the stop signal to the output devices
 
-Motors should be in a cross configuration, ordered as depicted
+The default Frame is a quad in the X configuration, ordered as depicted
 
   ^	Forward ^
   ---     ---
@@ -31,16 +31,25 @@ Motors should be in a cross configuration, ordered as depicted
   3 - clockwise
 
 */
+template<class Frame = Airframe::QuadX>
 class OutputManager{
+public:
+	static const uint8_t MOTORS = Frame::MOTORS;
 private:
+	enum Task{ NO_TASK, ARMING, CALIBRATING };
 	volatile boolean enabled, armed, standingby;
-	OutputDevice* 	 (&output)[4];
+	//arming or calibration in progress; the outputs are left to it
+	volatile Task    task;
+	boolean          started;
+	uint32_t         taskStart;
+	OutputDevice* 	 (&output)[MOTORS];
 	FlightStrategy*  flightMode;
+	void beginTask(Task t, uint16_t delay);
 public:
-	OutputManager(OutputDevice*   (&mots)[4], FlightStrategy* mode)
-		: output(mots), flightMode(mode) {}
-	OutputManager(OutputDevice* (&mots)[4])
-		: output(mots) {}
+	OutputManager(OutputDevice*   (&mots)[MOTORS], FlightStrategy* mode)
+		: task(NO_TASK), output(mots), flightMode(mode) {}
+	OutputManager(OutputDevice* (&mots)[MOTORS])
+		: task(NO_TASK), output(mots) {}
 	/** Set the flightStrategy used to balance the aircraft */
 	void setMode(FlightStrategy* mode){ flightMode = mode; }
 	/**
@@ -54,12 +63,41 @@ public:
 	void standby();
 	/** Enable flight, applying torques given by the flightStrategy */
 	void enable();
+	/**
+	 * Start having the connected OutputDevices arm themselves; the sequence
+	 * is run by calling `updateArming` from the main loop
+	 * Does nothing if already armed or arming
+	 * @param delay milliseconds to wait before starting
+	 */
+	void beginArming(uint16_t delay = 0);
+	/**
+	 * Start having the connected OutputDevices calibrate themselves, which
+	 * leaves them armed; run by `updateArming` like `beginArming`
+	 * Calibration fails if the outputs are already armed
+	 */
+	void beginCalibrate(uint16_t delay = 0);
+	/**
+	 * Advance an arming or calibration sequence; call frequently
+	 * @return True once the outputs are armed
+	 */
+	bool updateArming();
+	/** True while an arming or calibration sequence is running */
+	bool isArming(){ return task != NO_TASK; }
+	bool isArmed(){ return armed; }
+	/**
+	 * Fraction of the arming or calibration sequence done, from the time the
+	 * slowest OutputDevice takes; 1 once armed
+	 */
+	float armingProgress();
 	/** Have connected OutputDevices arm themselves; blocking */
 	void arm();
 	/** Have connected OutputDevices calibrate themselves; blocking */
 	void calibrate();
+	/** True while the motors are spinning, in standby or in flight */
+	bool isEnabled(){ return enabled; }
 };
-void OutputManager::enable(){
+template<class Frame>
+void OutputManager<Frame>::enable(){
 	if(!armed) return;
 	if(!enabled){
 		flightMode->reset();
@@ -67,73 +105,112 @@ void OutputManager::enable(){
 	standingby = false;
 	enabled = true;
 }
-void OutputManager::standby(){
+template<class Frame>
+void OutputManager<Frame>::standby(){
 	if(!enabled) enable();
 	standingby = true;
 }
-void OutputManager::disable(){
+template<class Frame>
+void OutputManager<Frame>::disable(){
 	standingby = false;
 	enabled = false;
 }
-void OutputManager::arm(){
-	uint32_t startTime = millis();
-	for(int i=0; i<4; i++){
-		output[i]->startArming();
-	}
-
-	//pass control around until all the ESC's are done arming
-	boolean finished;
-	do {
-		finished = true;
-		for(int i=0; i<4; i++){
-			finished &= output[i]->continueArming( millis()-startTime );
-		}
-	} while (!finished);
-
-	armed = true;
+template<class Frame>
+void OutputManager<Frame>::beginTask(Task t, uint16_t delay){
+	if(task != NO_TASK) return;
+	taskStart = millis() + delay;
+	started   = false;
+	task      = t;
+}
+template<class Frame>
+void OutputManager<Frame>::beginArming(uint16_t delay){
+	if(armed) return;
+	beginTask(ARMING, delay);
 }
-void OutputManager::calibrate(){
+template<class Frame>
+void OutputManager<Frame>::beginCalibrate(uint16_t delay){
 	//calibration will fail if the motors are already armed
 	if(armed) return;
+	beginTask(CALIBRATING, delay);
+}
+template<class Frame>
+bool OutputManager<Frame>::updateArming(){
+	if(task == NO_TASK) return armed;
+	uint32_t now = millis();
+	if((int32_t)(now - taskStart) < 0) return false;
 
-	uint32_t startTime = millis();
-	for(int i=0; i<4; i++){
-		output[i]->startCalibrate();
-	}
-
-	//pass control around until all the ESC's are done arming
-	boolean finished = false;
-	do{
-		finished = true;
-		for(int i=0; i<4; i++){
-			finished &= output[i]->continueCalibrate( millis()-startTime );
+	if(!started){
+		for(int i=0; i<MOTORS; i++){
+			if(task == ARMING) output[i]->startArming();
+			else               output[i]->startCalibrate();
 		}
-	} while (!finished);
+		started = true;
+	}
 
-	for(int i=0; i<4; i++){
-		output[i]->set(-1.0);
+	//pass control around until all the ESC's are done
+	uint32_t dt = now - taskStart;
+	boolean finished = true;
+	for(int i=0; i<MOTORS; i++){
+		if(task == ARMING) finished &= output[i]->continueArming(dt);
+		else               finished &= output[i]->continueCalibrate(dt);
 	}
+	if(!finished) return false;
 
+	if(task == CALIBRATING){
+		for(int i=0; i<MOTORS; i++){
+			output[i]->set(-1.0);
+		}
+	}
 	armed = true;
+	task  = NO_TASK;
+	return true;
+}
+template<class Frame>
+float OutputManager<Frame>::armingProgress(){
+	if(armed) return 1.0f;
+	if(task == NO_TASK) return 0.0f;
+	int32_t dt = millis() - taskStart;
+	if(dt <= 0) return 0.0f;
+	uint32_t longest = 0;
+	for(int i=0; i<MOTORS; i++){
+		uint32_t t = (task == ARMING)? output[i]->armingTime()
+		                             : output[i]->calibrateTime();
+		longest = max(longest, t);
+	}
+	if(longest == 0) return 0.0f;
+	return min(((float)dt)/longest, 0.99f);
+}
+template<class Frame>
+void OutputManager<Frame>::arm(){
+	beginArming();
+	while(!updateArming());
+}
+template<class Frame>
+void OutputManager<Frame>::calibrate(){
+	beginCalibrate();
+	while(task != NO_TASK) updateArming();
 }
-void OutputManager::update(OrientationEngine &orientation, float ms){
+template<class Frame>
+void OutputManager<Frame>::update(OrientationEngine &orientation, float ms){
+	if(task != NO_TASK) return;
 	if(!enabled || flightMode == NULL) {
-		for(int i=0; i<4; i++){ output[i]->set(-1.0); }
+		for(int i=0; i<MOTORS; i++){ output[i]->set(-1.0); }
 		return;
 	}
 	if(standingby) {
-		for(int i=0; i<4; i++){ output[i]->set(0.0); }
+		for(int i=0; i<MOTORS; i++){ output[i]->set(0.0); }
 		return;
 	}
 
 	float impulses[4];
 	flightMode->update(orientation,ms,impulses);
 
-	float outThrottle[4];
-	solveOutputs(impulses, outThrottle);
+	float outThrottle[MOTORS];
+	MotorMixer<Frame>::solve(impulses, outThrottle,
+	                         flightMode->getSaturation());
 
 	//set motor outputs
-	for(int i=0; i<4; i++){
+	for(int i=0; i<MOTORS; i++){
 		outThrottle[i] = constrain(outThrottle[i], 0.0f, 1.0f);
 		output[i]->set(outThrottle[i]);
 	}
@@ -0,0 +1,104 @@
+#ifndef THRUST_TABLE_H
+#define THRUST_TABLE_H
+
+#include "Arduino.h"
+#include "math/Algebra.h"
+
+/*
+ThrustTable -Linearizes a motor's thrust against its command
+			-maps a thrust fraction to the command fraction producing it
+			-looked up with integer interpolation between SEGMENTS+1 points
+
+Commands are returned as 16 bit fractions of full output, 0 to 65535, so an
+ESC can scale them to its pulse range without more floating point math.
+A new table is linear; it can be built from a measured thrust curve, from an
+expo model of the motors or from a polynomial in the thrust.
+*/
+class ThrustTable{
+public:
+	static const uint8_t  SEGMENTS = 16;
+	static const uint16_t FULL = 0xFFFF;
+private:
+	static const uint8_t  SEGMENT_BITS = 12; // 65536/SEGMENTS = 2^12
+	uint16_t table[SEGMENTS+1];
+	static uint16_t toFixed(float f){
+		return constrain(f, 0.0f, 1.0f)*FULL + 0.5f;
+	}
+public:
+	ThrustTable(){ setExpo(0.0f); }
+	explicit ThrustTable(const float (&horner)[4]){ setCurve(horner); }
+	/**
+	 * Build the table from thrust measured at evenly spaced commands, e.g.
+	 *     read off a thrust stand while stepping a motor through its range
+	 * @param thrust thrust at commands 0, 1/(count-1), ... 1; any units, but
+	 *               it must not decrease as the command increases
+	 * @param count  number of measurements, at least 2
+	 */
+	void characterise(const float* thrust, uint8_t count);
+	/**
+	 * Build the table for motors whose thrust follows
+	 *     thrust = (1-expo)*command + expo*command^2
+	 * @param expo 0 for linear thrust, up to 1 for thrust in the square of the
+	 *             command as from an ideal propeller
+	 */
+	void setExpo(float expo);
+	/** Build the table from command = cubicHorner(thrust, horner) */
+	void setCurve(const float (&horner)[4]);
+	/**
+	 * Look up the command for a thrust fraction
+	 * @param  thrust [0,1]; values outside are clamped
+	 * @return        The command, 0 to FULL
+	 */
+	uint16_t command(float thrust) const {
+		if(thrust <= 0.0f) return table[0];
+		if(thrust >= 1.0f) return table[SEGMENTS];
+		uint16_t x    = thrust*65536.0f;
+		uint8_t  i    = x >> SEGMENT_BITS;
+		uint16_t frac = x & ((1 << SEGMENT_BITS) - 1);
+		int32_t  step = (int32_t)table[i+1] - table[i];
+		return table[i] + ((step*frac) >> SEGMENT_BITS);
+	}
+	/** Scale a command to a range of `span` above `base` */
+	static uint16_t scale(uint16_t command, uint16_t base, uint16_t span){
+		return base + (((uint32_t)command*span + 0x8000) >> 16);
+	}
+};
+void
+ThrustTable::characterise(const float* thrust, uint8_t count){
+	if(count < 2) return;
+	const float low  = thrust[0];
+	const float high = thrust[count-1];
+	if(high <= low) return;
+	// walk the measurements once, inverting each segment they span
+	uint8_t m = 0;
+	for(uint8_t i=0; i<=SEGMENTS; i++){
+		float target = low + (high-low)*i/SEGMENTS;
+		while(m < count-2 && thrust[m+1] < target) m++;
+		float below = thrust[m], above = thrust[m+1];
+		float part  = (above > below)? (target-below)/(above-below) : 0.0f;
+		table[i] = toFixed((m + constrain(part, 0.0f, 1.0f))/(count-1));
+	}
+}
+void
+ThrustTable::setExpo(float expo){
+	expo = constrain(expo, 0.0f, 1.0f);
+	for(uint8_t i=0; i<=SEGMENTS; i++){
+		float thrust = ((float)i)/SEGMENTS;
+		float command;
+		if(expo == 0.0f){
+			command = thrust;
+		} else {
+			// positive root of expo*c^2 + (1-expo)*c - thrust = 0
+			float b = 1.0f - expo;
+			command = (sqrt(b*b + 4.0f*expo*thrust) - b)/(2.0f*expo);
+		}
+		table[i] = toFixed(command);
+	}
+}
+void
+ThrustTable::setCurve(const float (&horner)[4]){
+	for(uint8_t i=0; i<=SEGMENTS; i++){
+		table[i] = toFixed(cubicHorner(((float)i)/SEGMENTS, horner));
+	}
+}
+#endif
@@ -19,6 +19,14 @@ namespace Platform{
     HardwareSerial *commSerial = &Serial;
     CommManager comms(commSerial, eeStorage::getInstance());
 
+    // Radio input; define RADIO_SBUS before including this to read an SBUS
+    // receiver on Serial2 instead of the PPM input
+    #ifdef RADIO_SBUS
+    namespace Radio = SBUSRadio;
+    #else
+    namespace Radio = APMRadio;
+    #endif
+
     // Sensors
     MPU6000 mpu;
     HMC5883L hmc;
@@ -26,8 +34,16 @@ namespace Platform{
     MS5611 baro;
     Power power;
 
+    // Sensors started by `startAPM`, in the order they are checked
+    const uint8_t NUM_SENSORS = 4;
+    Sensor* apmSensors[NUM_SENSORS] = {&mpu, &hmc, &baro, &gps};
+
     // State variables
     bool errorsDetected = false;
+    // millis() when `startAPM` ran
+    uint32_t startTime;
+    // one bit per sensor that hasn't finished starting up
+    uint8_t sensorsStarting = 0;
 
     /**
      * Returns true if none of the hardware has reported an error
@@ -36,14 +52,42 @@ namespace Platform{
         return !errorsDetected;
     }
 
+    /** True once every sensor has finished starting up */
+    bool sensorsReady(){
+        return sensorsStarting == 0;
+    }
+
+    /**
+     * Advance the sensors' startup; they all run in parallel, each at its
+     * own pace, and are checked once the last is done
+     */
+    void updateSensorStartup(){
+        if(sensorsReady()) return;
+        uint32_t dt = millis() - startTime;
+        for(int i=0; i<NUM_SENSORS; i++){
+            if(!(sensorsStarting & _BV(i))) continue;
+            if(apmSensors[i]->continueInit(dt)) sensorsStarting &= ~_BV(i);
+        }
+        if(!sensorsReady()) return;
+
+        for(int i=0; i<NUM_SENSORS; i++) {
+            auto status = apmSensors[i]->status();
+            if(!status.good()){
+                errorsDetected = true;
+                comms.sendString(status.message);
+            }
+        }
+    }
+
     /**
-     * Initialize the Ardupilot hardware
+     * Initialize the Ardupilot hardware without waiting on the sensors; they
+     * finish starting up in `updateAPM`, after which `sensorsReady` is true
      * Should only be called once
      */
-    void beginAPM(){
+    void startAPM(){
         // Enable IO
         commSerial->begin(Protocol::BAUD_RATE);
-        APMRadio::setup();
+        Radio::setup();
         ServoGenerator::begin();
 
         // Load accelerometer/magnetometer parameters from EEPROM
@@ -58,19 +102,25 @@ namespace Platform{
             hmc.tune(settings.getMagTune());
         }
 
-        // Startup the onboard sensors
-        Sensor* sensors[] = {&mpu, &hmc, &baro, &gps};
-        for(int i=0; i<4; i++) sensors[i]->begin();
-        delay(50);
-        for(int i=0; i<4; i++) sensors[i]->calibrate();
-        delay(50);
-        for(int i=0; i<4; i++) {
-            auto status = sensors[i]->status();
-            if(!status.good()){
-                errorsDetected = true;
-                comms.sendString(status.message);
-            }
+        // The gyro temperature tune is optional; without it the bias is
+        // only corrected by the arming calibration
+        if(settings.foundGyroTempTune()){
+            mpu.tuneGyroTemp(settings.getGyroTempTune());
         }
+
+        // Startup the onboard sensors
+        startTime = millis();
+        for(int i=0; i<NUM_SENSORS; i++) apmSensors[i]->startInit();
+        sensorsStarting = _BV(NUM_SENSORS) - 1;
+    }
+
+    /**
+     * Initialize the Ardupilot hardware, returning once the sensors are ready
+     * Should only be called once
+     */
+    void beginAPM(){
+        startAPM();
+        while(!sensorsReady()) updateSensorStartup();
     }
 
     /**
@@ -82,6 +132,11 @@ namespace Platform{
      */
     void updateAPM() {
         comms.update();
+    #ifdef RADIO_SBUS
+        // often enough to see the gaps between frames
+        Radio::update();
+    #endif
+        updateSensorStartup();
         gps.update();
     }
 }
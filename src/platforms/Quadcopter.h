@@ -6,6 +6,7 @@
 
 namespace Platform {
     // Output devices
+    // Define Output_t as OneShotESC before including this for OneShot125 ESCs
     #ifndef Output_t
     #define Output_t AfroESC
     #endif
@@ -13,13 +14,24 @@ namespace Platform {
         { Output_t(12/*CCW TR APM 1*/), Output_t(11/*CCW BL APM 2*/),
           Output_t( 8/*CW  TL APM 3*/), Output_t( 7/*CW  BR APM 4*/) };
     OutputDevice* outDev[4] = {&esc[0], &esc[1], &esc[2], &esc[3]};
-    OutputManager output(outDev);
+    OutputManager<Airframe::QuadX> output(outDev);
+    // Thrust linearization shared by the ESCs; built by settings into the
+    // table the ESCs aren't reading, then swapped in
+    ThrustTable thrustTables[2];
+    uint8_t thrustFront = 0;
 
     // Inertial sensors and their frame translators
+    enum InertialIndex{ IMU_HMC = 0, IMU_MPU = 1 };
     InertialVec* sens[2] = {&hmc, &mpu};
     Translator   conv[2] = {Translators::APM, Translators::APM};
     InertialManager imu(sens, conv, 2);
 
+    // Orders the sensor bus reads made in each control frame
+    BusScheduler busScheduler;
+
+    // Slots in util/profile.h; the main loop's is timed by the sketch
+    enum ProfileIndex{ PROFILE_ISR = 0, PROFILE_LOOP = 1 };
+
     // Horizon flight controller and attitude PID parameters
     PIDparameters attPID(  -1,  1), yawPID(  -1,  1);
     PIDparameters attVel(-100,100), yawVel(-100,100);
@@ -35,6 +47,7 @@ namespace Platform {
 
     // Input parameter variables; default values rewritten by settings
     ThrottleCurve throttleCurve(0.0, 0.0);
+    ExpoCurve stickCurve;
     float YawTargetSlewRate;
     float AltitudeTargetSlewRate;
     float magneticDeclination;
@@ -43,30 +56,64 @@ namespace Platform {
 
     // Minimum time between orientation and output updates in milliseconds
     const float MINIMUM_INT_PERIOD = 5000;
+    // Range the period may be tuned over when "Auto Period Margin" is set;
+    // 2500 (400Hz) is the fastest update rate common PWM ESCs accept
+    const uint16_t MINIMUM_AUTO_PERIOD = 2500;
+    const uint16_t MAXIMUM_AUTO_PERIOD = 10000;
+
+    // Shortens the period to what the control loop can sustain
+    PeriodTuner periodTuner;
 
     // Quadcopter state trackers; defaults rewritten by settings
     Altitude altitude;
     RCFilter orientation(0.0,0.0);
 
+    // Milliseconds for the ESCs to power up before arming or calibrating
+    const uint16_t ESC_STARTUP_DELAY = 500;
+
     /**
-     * Arm all the motors.
+     * Start arming all the motors; the arming sequence runs in
+     * `updateMultirotor` while everything else keeps running.
      * Safe to call a second time.
-     * Blocking call.
      */
     void arm(){
-        delay(500);
-        output.arm();
+        output.beginArming(ESC_STARTUP_DELAY);
     }
 
     /**
-     * Send the calibration sequence to the motors.
+     * Start the calibration sequence for the motors; it runs in
+     * `updateMultirotor`, or in `output.updateArming` without the platform.
      * Usually, this leaves them armed, and running when armed will cause
      * dangerous behavior.
-     * Blocking call.
      */
     void calibrateESCs(){
-        delay(500);
-        output.calibrate();
+        output.beginCalibrate(ESC_STARTUP_DELAY);
+    }
+
+    /** Milliseconds between calls to `isrCallback`, used by the flight task */
+    float framePeriod;
+
+    /**
+     * Register the reads and calculations made in each control frame
+     *
+     * The MPU6000 is always read first, immediately followed by the
+     *   orientation and output updates that depend on it. The compass only
+     *   starts a transfer that completes on its own, and the barometer read
+     *   takes ~.1 ms of SPI time every other frame; both run after the
+     *   flight critical work, in frames picked to keep each frame short
+     */
+    void setupBusSchedule(){
+        busScheduler.add([](){ imu.update(IMU_MPU); },
+                         1, BusScheduler::SPI_BUS, 100,   0);
+        busScheduler.add([](){
+                            orientation.update(imu, framePeriod);
+                            output.update(orientation, framePeriod);
+                         },
+                         1, BusScheduler::NO_BUS, 1000, 200);
+        busScheduler.add([](){ imu.update(IMU_HMC); },
+                         2, BusScheduler::TWI_BUS, 200, 3000);
+        busScheduler.add([](){ baro.update(); },
+                         2, BusScheduler::SPI_BUS, 100, 3000);
     }
 
     /**
@@ -75,26 +122,28 @@ namespace Platform {
      *
      * It also includes the barometer update, because, while not flight critical
      *   it is best to keep all SPI bus reads in the same "thread" and
-     *   consistently timed. Reading the barometer takes ~.1 ms
+     *   consistently timed. The order of the work is set in `setupBusSchedule`
      */
     void isrCallback(uint16_t microseconds) {
-        tic(0);
-        float ms = ((float)microseconds)/1000.0;
-        imu.update();
-        orientation.update(imu, ms);
-        output.update(orientation, ms);
-        baro.update();
-        toc(0);
+        tic(PROFILE_ISR);
+        framePeriod = ((float)microseconds)/1000.0;
+        // the sensors are still being configured from the main loop
+        if(sensorsReady()) busScheduler.run();
+        toc(PROFILE_ISR);
     }
 
     /**
      * Update the frequency that the servo signal generator refreshes and that
      * `isrCallback` is run.
+     * With auto period on this is only the starting period
      */
     void changeInterruptPeriod(float newPeriod){
         if(newPeriod < MINIMUM_INT_PERIOD) newPeriod = MINIMUM_INT_PERIOD;
         ServoGenerator::setUpdateCallback(isrCallback);
+        // send the motor outputs in the frame they were computed
+        ServoGenerator::setFrameMode(ServoGenerator::SAME_FRAME);
         ServoGenerator::begin(newPeriod);
+        periodTuner.begin(newPeriod, MINIMUM_AUTO_PERIOD, MAXIMUM_AUTO_PERIOD);
     }
 
     void setupSettings();
@@ -102,13 +151,19 @@ namespace Platform {
     /**
      * Startup code for initializing the Multirotor
      * This should be called once
-     * Arms the drone
+     * Starts the sensors and arming the drone, which finish in
+     * `updateMultirotor`; `ready` tells when they are done
      */
     void beginMultirotor() {
-        beginAPM();
+        profileName(PROFILE_ISR, "isr");
+        profileName(PROFILE_LOOP, "loop");
+        // before anything else starts interrupting
+        CpuLoad::calibrate();
+        startAPM();
+        setupBusSchedule();
         setupSettings();
 
-        // Settings should be set before `arm`, because serial signal fresh
+        // Settings should be set before `arm`, because serial signal refresh
         // period is a setting
         arm();
 
@@ -119,6 +174,26 @@ namespace Platform {
 
         comms.requestResync();
         output.setMode(&horizon);
+
+        // a run of another build says nothing about this one
+        uint16_t lastHeadroom = MemoryMonitor::lastRunHeadroom();
+        if(lastHeadroom != MemoryMonitor::UNKNOWN && settings.foundSettings()){
+            settings.recordStackHeadroom(lastHeadroom);
+            if(lastHeadroom == 0){
+                /*#STACKCRASH The last run ended in a reset after its stack
+                 * ran into the heap; there is not enough free memory
+                **/
+                comms.sendString("STACKCRASH");
+            }
+        }
+    }
+
+    // milliseconds from `beginMultirotor` until `ready`; 0 until then
+    uint32_t readyTime = 0;
+
+    /** True once the sensors have started up and the ESCs are armed */
+    bool ready(){
+        return sensorsReady() && output.isArmed();
     }
 
     /**
@@ -128,8 +203,17 @@ namespace Platform {
      */
     void updateMultirotor() {
         updateAPM();
+        output.updateArming();
+        if(readyTime == 0 && ready()) readyTime = millis() - startTime;
+        // only speed the loop up while the motors are stopped
+        periodTuner.update(!output.isEnabled());
         altitude.update(baro.getAltitude());
         power.checkCapacity(comms);
+        OutputDevice::setCommandGain(power.voltageCompensation());
+        CpuLoad::update();
+        if(MemoryMonitor::update()){
+            settings.recordStackHeadroom(MemoryMonitor::stackHeadroom());
+        }
     }
 
     /**
@@ -145,6 +229,9 @@ namespace Platform {
             comms.sendString("DEFAULTS");
         }
 
+        // the callbacks below all run together in `endAttach`
+        settings.beginAttach();
+
         // these setting messages are specially formatted so a tool in the dashboard
         // can parse them and display the full text. For now, indexes must be unique
         // and both indexes and def (default) values will need to be present in
@@ -353,6 +440,64 @@ namespace Platform {
          *   fall at when auto landing because of a radio signall loss
          */
         settings.attach(32, 1.0f, [](float g){ autolandDescentRate = g; });
+
+        /*AIRSETTING index="33" name="Auto Period Margin" min="0.0" max="1.0" def="0.0"
+         *When above 0, the Output Period is only a starting point; while the
+         *motors are stopped the period is shortened to the fastest the
+         *control loop can keep up with, leaving this fraction of the longest
+         *measured loop time spare. Skipped frames lengthen it again at any
+         *time. 0.3 is a reasonable margin; 0 keeps the Output Period fixed
+         */
+        settings.attach(33, 0.0f, [](float g){ periodTuner.setMargin(g); });
+
+        /*AIRSETTING index="34" name="Stick Expo" min="0.0" max="1.0" def="0.0"
+         *Softens the pitch, roll and yaw sticks around center while keeping
+         *the same full stick response. 0 is linear; 1 is fully cubic
+         */
+        settings.attach(34, 0.0f, [](float g){ stickCurve.set(g, 1.0f); });
+
+        /*AIRSETTING index="35" name="Stick Feed Forward" min="0.0" max="1.0" def="0.0"
+         *Fraction of the stick movement rate passed directly to the rate
+         *loops, so the quadcopter starts turning as the sticks move instead of
+         *waiting for an attitude error to build. Start around 0.5
+         */
+        settings.attach(35, 0.0f, [](float g){ horizon.setFeedForward(g); });
+
+        /*AIRSETTING index="36" name="Air Mode" min="0" max="1" def="0"
+         *1 keeps full pitch, roll and yaw authority at any throttle by raising
+         *or lowering the total motor output as needed, giving up yaw first
+         *when the motors can't deliver everything asked of them. 0 only
+         *lowers the output near full throttle, so control weakens near idle
+         */
+        settings.attach(36, 0.0f, [](float g){
+            horizon.setSaturation((g != 0.0f)? MIX_AIRMODE : MIX_HEADROOM); });
+
+        /*AIRSETTING index="37" name="Thrust Expo" min="0.0" max="1.0" def="0.0"
+         *How far the motors' thrust bends from linear towards the square of
+         *the ESC signal; the ESC outputs are corrected so thrust follows the
+         *flight controller linearly. Around 0.6 is typical for fixed pitch
+         *props; 0 leaves each ESC's own response
+         */
+        settings.attach(37, 0.0f, [](float g){
+            // the ESCs are set from the output interrupt, so the table they
+            // use can't be rebuilt in place
+            ThrustTable& back = thrustTables[thrustFront^1];
+            back.setExpo(g);
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+                for(int i=0; i<4; i++)
+                    esc[i].setThrustTable((g != 0.0f)? &back : NULL);
+            }
+            thrustFront ^= 1;
+        });
+
+        /*AIRSETTING index="38" name="Tuned Voltage" min="0.0" max="+inf" def="0.0"
+         *The battery voltage the PID gains were tuned at. The motor outputs
+         *are scaled by this over the measured voltage, so the quadcopter
+         *responds the same on a full or a sagging pack. 0 turns this off
+         */
+        settings.attach(38, 0.0f, [](float g){ power.setReferenceVoltage(g); });
+
+        settings.endAttach();
     }
 }
 #endif
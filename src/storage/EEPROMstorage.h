@@ -15,6 +15,12 @@ class eeStorage : public Storage<EE_STORAGE_TYPE> {
 private:
 	static eeStorage* m_instance;
 	void (*callback[NUM_STORED_RECORDS])(EE_STORAGE_TYPE);
+	//one bit per record whose callback is waiting for `fireCallbacks`
+	uint8_t pending[(NUM_STORED_RECORDS+7)/8];
+	void setPending(uint8_t dataNum, bool p){
+		if(p) pending[dataNum/8] |=   1 << (dataNum%8);
+		else  pending[dataNum/8] &= ~(1 << (dataNum%8));
+	}
 	eeStorage();
 public:
 	static eeStorage* getInstance(){
@@ -22,6 +28,8 @@ public:
 		return m_instance;
 	}
 	void attachCallback(uint8_t dataNum, void (*call)(EE_STORAGE_TYPE));
+	void attachCallbackLater(uint8_t dataNum, void (*call)(EE_STORAGE_TYPE));
+	void fireCallbacks();
 	void updateRecord(uint8_t dataNum, EE_STORAGE_TYPE value);
 	EE_STORAGE_TYPE getRecord(uint8_t dataNum);
 };
@@ -30,17 +38,37 @@ eeStorage* eeStorage::m_instance = NULL;
 eeStorage::eeStorage(){
 	eeprom::setup();
 	for(int i=0; i<NUM_STORED_RECORDS; i++) callback[i] = NULL;
+	for(unsigned i=0; i<sizeof(pending); i++) pending[i] = 0;
 }
 void
 eeStorage::attachCallback(uint8_t dataNum, void (*call)(EE_STORAGE_TYPE)){
 	if(dataNum >= NUM_STORED_RECORDS) return;
 	callback[dataNum] = call;
+	setPending(dataNum, false);
 	if(call != NULL) call(getRecord(dataNum));
 }
 void
+eeStorage::attachCallbackLater(uint8_t dataNum, void (*call)(EE_STORAGE_TYPE)){
+	if(dataNum >= NUM_STORED_RECORDS) return;
+	callback[dataNum] = call;
+	setPending(dataNum, call != NULL);
+}
+void
+eeStorage::fireCallbacks(){
+	// one wait for queued writes, then every record is read back to back
+	byteConv data;
+	for(uint8_t i=0; i<NUM_STORED_RECORDS; i++){
+		if(!(pending[i/8] & (1 << (i%8)))) continue;
+		setPending(i, false);
+		eeprom::readBlock(EEaddrStart+4*i, data.bytes, 4);
+		callback[i](data.f);
+	}
+}
+void
 eeStorage::updateRecord(uint8_t dataNum, EE_STORAGE_TYPE value){
 	if(dataNum >= NUM_STORED_RECORDS) return;
 	eeprom::writeFloat(EEaddrStart+4*dataNum, value);
+	setPending(dataNum, false);
 	if(callback[dataNum] != NULL) callback[dataNum](value);
 }
 EE_STORAGE_TYPE
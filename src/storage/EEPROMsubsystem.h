@@ -6,6 +6,8 @@
 #include "storage/EEPROMconfig.h"
 #include "storage/queue.h"
 #include "util/byteConv.h"
+#include "util/CpuLoad.h"
+#include "util/Trace.h"
 #include <util/atomic.h>
 
 struct eepromWrite{
@@ -31,6 +33,7 @@ public:
 	static uint8_t  safeRead(EEaddr addr);//reads eeprom, blocking if necessary
 	static uint32_t readLong(EEaddr addr);
 	static float    readFloat(EEaddr addr);
+	static void     readBlock(EEaddr addr, uint8_t* data, uint16_t len);
 	static void disableInterrupt();
 private:
 	static void enableInterrupt();
@@ -114,7 +117,23 @@ eeprom::readFloat(EEaddr addr){
 	for(int i=0; i<4; i++) data.bytes[i] = safeRead(addr+i);
 	return data.f;
 }
+void
+eeprom::readBlock(EEaddr addr, uint8_t* data, uint16_t len){
+	//wait for chance to Read once, rather than for every byte
+	while( !eeprom::safeToRead() ) eeprom::enableInterrupt();
+	for(uint16_t i=0; i<len; i++){
+		EEaddr a = addr+i;
+		if(a == EENULL || a >= EE_MAX){
+			data[i] = 0;
+			continue;
+		}
+		EEAR = a;
+		bitSet(EECR, EERE); //start read; takes 4 cycles
+		data[i] = EEDR;
+	}
+}
 ISR(EE_READY_vect){
+	CpuLoad::IsrTimer timer(CpuLoad::EEPROM_ISR);
 	//cycle queue through writing process and write
 	uint8_t oldSREG = SREG;
 	if(_eepromWriteQueue.isEmpty()){
@@ -123,6 +142,7 @@ ISR(EE_READY_vect){
 		return;
 	}
 	eepromWrite write = _eepromWriteQueue.pop();
+	Trace::mark(Trace::EEPROM_WRITE, write.addr);
 	EEAR = write.addr;
 	EEDR = write.data;
 	EECR = (EECR & 0xf8)|0x04; //write 1 to EEMPE and 0 to EEPE
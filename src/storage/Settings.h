@@ -3,6 +3,7 @@
 
 #include "storage/EEPROMconfig.h"
 #include "storage/Storage.h"
+#include "util/GyroTempTune.h"
 #include "util/LTATune.h"
 
 namespace commonSettings{
@@ -11,7 +12,19 @@ namespace commonSettings{
 									+__TIME__[3]*100
 									+__TIME__[4]*1000;
 	static const uint16_t CALIBRATION_VERSON = 8;
+	static const uint16_t GYRO_TEMP_VERSION = 1;
+	// stack record before anything has been recorded for this build
+	static const uint16_t NO_STACK_RECORD = 0xffff;
 	enum Common{
+		STACK_RECORD	= 41,
+		GYRO_X_TSHFT	= 42,
+		GYRO_Y_TSHFT	= 43,
+		GYRO_Z_TSHFT	= 44,
+		GYRO_X_TSLP	= 45,
+		GYRO_Y_TSLP	= 46,
+		GYRO_Z_TSLP	= 47,
+		GYRO_TREF	= 48,
+		GYRO_TEMP_VER	= 49,
 		ACCL_X_SHFT	= 50,
 		ACCL_Y_SHFT	= 51,
 		ACCL_Z_SHFT	= 52,
@@ -34,11 +47,13 @@ class Settings{
 	// attach is a single action
 	// keeps track of weather or not storage was initialized
 	// structured and safe retreival of 2 LTATunes from memory
+	// structured and safe retreival of the gyro temperature tune
 private:
 	Storage<EE_STORAGE_TYPE> *storage = NULL;
 	bool formatChecked = false;
 	bool validFormat = false;
 	bool validCalib  = false;
+	bool deferring   = false;
 public:
 	Settings(Storage<EE_STORAGE_TYPE> *str) : storage(str) {
 	}
@@ -46,6 +61,10 @@ public:
 		if (!formatChecked) checkStorageFormat();
 		return validCalib;
 	}
+	bool foundGyroTempTune(){
+		if(storage == NULL) return false;
+		return (storage->getRecord(GYRO_TEMP_VER) == GYRO_TEMP_VERSION);
+	}
 	bool foundSettings(){
 		if (!formatChecked) checkStorageFormat();
 		return validFormat;
@@ -54,7 +73,11 @@ public:
 		if(storage == NULL) return;
 		validCalib  = (storage->getRecord(CALIB_VER  ) == CALIBRATION_VERSON);
 		validFormat = (storage->getRecord(STORAGE_VER) == VERSION);
-		if (!validFormat) storage->updateRecord(STORAGE_VER, VERSION);
+		if (!validFormat) {
+			storage->updateRecord(STORAGE_VER, VERSION);
+			// headroom from another build says nothing about this one
+			storage->updateRecord(STACK_RECORD, NO_STACK_RECORD);
+		}
 		formatChecked = true;
 	}
 	void writeCalibrationVersion(){
@@ -69,11 +92,46 @@ public:
 		}
 		writeCalibrationVersion();
 	}
+	void writeGyroTempTune(GyroTempTune tune){
+		if(storage == NULL) return;
+		for(int i=0; i<7; i++){
+			storage->updateRecord(GYRO_X_TSHFT+i, tune.raw[i]);
+		}
+		storage->updateRecord(GYRO_TEMP_VER, GYRO_TEMP_VERSION);
+	}
+	/** Lowest stack headroom in bytes recorded since this build was uploaded */
+	uint16_t getStackRecord(){
+		if(!formatChecked) checkStorageFormat();
+		if(storage == NULL) return NO_STACK_RECORD;
+		return storage->getRecord(STACK_RECORD);
+	}
+	/** Store `bytes` of stack headroom if it is below the recorded low */
+	void recordStackHeadroom(uint16_t bytes){
+		if(storage == NULL) return;
+		if(bytes < getStackRecord()) storage->updateRecord(STACK_RECORD, bytes);
+	}
+	/**
+	 * Hold back the callbacks of the `attach` calls that follow until
+	 * `endAttach`, which loads all of their stored values in one pass
+	 */
+	void beginAttach(){
+		deferring = true;
+	}
+	void endAttach(){
+		deferring = false;
+		if(storage != NULL) storage->fireCallbacks();
+	}
 	bool attach(int type, EE_STORAGE_TYPE defaul, void (*call)(EE_STORAGE_TYPE)){
 		if(!formatChecked) checkStorageFormat();
 		if(storage == NULL) return false;
 		uint8_t index = (int)type;
 
+		if (deferring) {
+			// writing the default calls back with it, without a read
+			storage->attachCallbackLater(index, call);
+			if (!validFormat) storage->updateRecord(index, defaul);
+			return true;
+		}
 		if (!validFormat) {
 			storage->updateRecord(index, defaul);
 		}
@@ -102,6 +160,14 @@ public:
 		if(!formatChecked) checkStorageFormat();
 		return getTuneAt( MAG_X_SHFT);
 	}
+	GyroTempTune getGyroTempTune(){
+		GyroTempTune output;
+		if(!foundGyroTempTune()) return output;
+		for(int i=0; i<7; i++){
+			output.raw[i] = storage->getRecord(GYRO_X_TSHFT+i);
+		}
+		return output;
+	}
 };
 
 #endif
@@ -12,6 +12,16 @@ public:
      * the current value
      */
 	virtual void attachCallback(uint8_t dataNum, void (*call)(T))=0;
+    /**
+     * Attach a callback like `attachCallback`, but hold off calling it until
+     * the next `fireCallbacks` or update of its record, so storage that is
+     * slow to read can load many records at once
+     */
+	virtual void attachCallbackLater(uint8_t dataNum, void (*call)(T)){
+		attachCallback(dataNum, call);
+	}
+    /** Call the callbacks held off by `attachCallbackLater` */
+	virtual void fireCallbacks(){}
     /**
      * Update the data at location `dataNum` to `value`, firing attached
      * callbacks as necessary
@@ -0,0 +1,210 @@
+#ifndef BUSSCHEDULER_H
+#define BUSSCHEDULER_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "util/profile.h"
+#include "util/Trace.h"
+
+/**
+ * Runs the sensor bus transactions of a control frame in a planned order
+ *
+ * Each task declares how often it runs (every `divider` frames), the bus it
+ *     uses, how long it is expected to hold that bus, and a deadline in
+ *     microseconds from the start of the frame. Every frame the due tasks run
+ *     in deadline order, so a deadline of 0 always goes first.
+ * Tasks that do not run every frame are given the phase offset that keeps the
+ *     busiest frame on their bus as short as possible, so slow sensors take
+ *     turns instead of piling up in the same frame.
+ * Timing of each task and of the whole frame is recorded for reporting, and
+ *     `statsLine` formats it as text.
+ *
+ * Tasks should all be added before the scheduler starts running
+ */
+class BusScheduler{
+public:
+    enum Bus : uint8_t { SPI_BUS, TWI_BUS, NO_BUS, NUM_BUSES };
+    typedef void (*Task)();
+    /** Maximum number of tasks that can be registered */
+    static const uint8_t MAX_TASKS = 8;
+    /**
+     * Number of frames in a full schedule cycle; dividers are rounded down to
+     *     a factor of this
+     */
+    static const uint8_t CYCLE_FRAMES = 16;
+
+    class Stats{
+    public:
+        Stats(): last(0), longest(0), total(0), count(0), late(0) {}
+        /** most recent and longest measured duration in microseconds */
+        uint16_t last, longest;
+        uint32_t total;
+        /** number of runs and number of runs started after the deadline */
+        uint16_t count, late;
+        uint16_t mean() const { return (count == 0)? 0 : total/count; }
+        void record(uint16_t time, bool wasLate){
+            last = time;
+            if(time > longest) longest = time;
+            total += time;
+            count++;
+            if(wasLate) late++;
+            // keep the running mean from overflowing
+            if(count == 0xffff){
+                total /= 2;
+                count /= 2;
+            }
+        }
+    };
+private:
+    struct Entry{
+        Task     task;
+        uint8_t  divider;
+        uint8_t  phase;
+        Bus      bus;
+        uint16_t expected;
+        uint16_t deadline;
+    };
+    Entry entries[MAX_TASKS];
+    // indices into `entries` sorted by deadline
+    uint8_t order[MAX_TASKS];
+    uint8_t numTasks;
+    uint8_t frame;
+    // expected bus time planned in each frame of the cycle
+    uint16_t load[NUM_BUSES][CYCLE_FRAMES];
+    // written from the frame interrupt; only read with interrupts disabled
+    Stats taskStats[MAX_TASKS];
+    Stats frameStats;
+    static Stats copy(const Stats& s);
+public:
+    BusScheduler(): numTasks(0), frame(0) {
+        for(uint8_t b=0; b<NUM_BUSES; b++)
+            for(uint8_t f=0; f<CYCLE_FRAMES; f++) load[b][f] = 0;
+    }
+    /**
+     * Register a task
+     * @param  task     Function doing the bus transaction
+     * @param  divider  The task runs once every `divider` frames
+     * @param  bus      Bus the task holds while it runs
+     * @param  expected Expected bus time in microseconds
+     * @param  deadline Latest start time in microseconds after frame start
+     * @return          the task's index for `getStats`, or -1 if full
+     */
+    int8_t add(Task task, uint8_t divider, Bus bus,
+               uint16_t expected, uint16_t deadline);
+    /** Run all tasks due this frame; call once per control frame */
+    void run();
+    uint8_t size(){ return numTasks; }
+    /** Phase offset in frames chosen for task `i` */
+    uint8_t phase(uint8_t i){ return entries[i].phase; }
+    /** Timing of task `i` */
+    Stats getStats(uint8_t i){ return copy(taskStats[i]); }
+    /** Timing of every task run in a frame together */
+    Stats getFrameStats(){ return copy(frameStats); }
+    /** Clear all recorded timing */
+    void resetStats();
+    /**
+     * Write a report of task `i`, or of the whole frame when `i` is `size()`,
+     *     into `buf` as "bus<i> n:count avg:mean hi:longest late:late", with
+     *     times in microseconds and the frame named "bus frame"
+     * @param  buf Where to write the report; it is always null terminated
+     * @param  len Size of `buf`
+     * @return     Length of the report; 0 if there is no line `i`
+     */
+    uint8_t statsLine(uint8_t i, char* buf, uint8_t len);
+};
+BusScheduler::Stats
+BusScheduler::copy(const Stats& s){
+    Stats out;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        out = s;
+    }
+    return out;
+}
+int8_t
+BusScheduler::add(Task task, uint8_t divider, Bus bus,
+                  uint16_t expected, uint16_t deadline){
+    if(numTasks >= MAX_TASKS) return -1;
+
+    if(divider < 1) divider = 1;
+    while(CYCLE_FRAMES % divider != 0) divider--;
+
+    // pick the phase whose busiest frame on this bus is the least loaded,
+    // breaking ties with the load across all buses
+    uint8_t  bestPhase = 0;
+    uint16_t bestPeak  = 0xffff;
+    uint32_t bestTotal = 0xffffffff;
+    for(uint8_t p=0; p<divider; p++){
+        uint16_t peak  = 0;
+        uint32_t total = 0;
+        for(uint8_t f=p; f<CYCLE_FRAMES; f+=divider){
+            peak = max(peak, load[bus][f]);
+            for(uint8_t b=0; b<NUM_BUSES; b++) total += load[b][f];
+        }
+        if(peak < bestPeak || (peak == bestPeak && total < bestTotal)){
+            bestPhase = p;
+            bestPeak  = peak;
+            bestTotal = total;
+        }
+    }
+    for(uint8_t f=bestPhase; f<CYCLE_FRAMES; f+=divider){
+        load[bus][f] += expected;
+    }
+
+    uint8_t i = numTasks;
+    entries[i] = {task, divider, bestPhase, bus, expected, deadline};
+
+    // insert into the run order; equal deadlines keep registration order
+    uint8_t pos = i;
+    while(pos > 0 && entries[order[pos-1]].deadline > deadline){
+        order[pos] = order[pos-1];
+        pos--;
+    }
+    order[pos] = i;
+
+    numTasks++;
+    return i;
+}
+void
+BusScheduler::run(){
+    uint32_t frameStart = micros();
+    for(uint8_t k=0; k<numTasks; k++){
+        const uint8_t i = order[k];
+        const Entry& e = entries[i];
+        if(frame % e.divider != e.phase) continue;
+
+        uint32_t start = micros();
+        Trace::begin(Trace::BUS_TASK, i);
+        e.task();
+        Trace::end(Trace::BUS_TASK, i);
+        uint32_t end = micros();
+        taskStats[i].record(end-start, (start-frameStart) > e.deadline);
+    }
+    frameStats.record(micros()-frameStart, false);
+    frame = (frame+1) % CYCLE_FRAMES;
+}
+void
+BusScheduler::resetStats(){
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        for(uint8_t i=0; i<MAX_TASKS; i++) taskStats[i] = Stats();
+        frameStats = Stats();
+    }
+}
+uint8_t
+BusScheduler::statsLine(uint8_t i, char* buf, uint8_t len){
+    if(len == 0) return 0;
+    buf[0] = '\0';
+    if(i > numTasks) return 0;
+    Stats s = (i == numTasks)? getFrameStats() : getStats(i);
+    char* p   = buf;
+    char* end = buf + len - 1;
+    p = appendText(p, end, "bus");
+    if(i == numTasks) p = appendText(p, end, " frame");
+    else              p = appendNumber(p, end, i);
+    p = appendText(p, end, " n:");    p = appendNumber(p, end, s.count);
+    p = appendText(p, end, " avg:");  p = appendNumber(p, end, s.mean());
+    p = appendText(p, end, " hi:");   p = appendNumber(p, end, s.longest);
+    p = appendText(p, end, " late:"); p = appendNumber(p, end, s.late);
+    *p = '\0';
+    return p - buf;
+}
+#endif
@@ -0,0 +1,83 @@
+#include "CpuLoad.h"
+#include <util/atomic.h>
+
+namespace CpuLoad{
+    volatile uint32_t isrTicks[NUM_SOURCES];
+    volatile uint32_t timedTicks;
+}
+
+using namespace CpuLoad;
+
+namespace {
+    // calibration window in profileClock ticks; short enough that timer0
+    // overflows at most once while its interrupt is held off
+    constexpr uint16_t CALIBRATE_TICKS = 200;
+
+    // idle counts per profileClock tick with nothing else running
+    float idleRate = 0;
+
+    uint32_t windowStart;
+    uint32_t idleCount;
+    uint32_t windowIsrTicks[NUM_SOURCES];
+
+    float totalLoad;
+    float sourceLoad[NUM_SOURCES];
+
+    // count for `ticks` of profileClock; the loop is the same one `idle` runs
+    uint32_t spin(uint32_t ticks){
+        const uint32_t start = profileClock();
+        uint32_t count = 0;
+        while(profileClock() - start < ticks) count++;
+        return count;
+    }
+}
+
+namespace CpuLoad{
+    void calibrate(){
+        uint32_t count;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            count = spin(CALIBRATE_TICKS);
+        }
+        idleRate = ((float)count)/CALIBRATE_TICKS;
+        idleCount = 0;
+        windowStart = profileClock();
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            for(uint8_t i=0; i<NUM_SOURCES; i++) windowIsrTicks[i] = isrTicks[i];
+        }
+    }
+
+    void idle(uint16_t microseconds){
+        idleCount += spin(microseconds/PROFILE_TICK);
+    }
+
+    void update(){
+        const uint32_t now = profileClock();
+        const uint32_t elapsed = now - windowStart;
+        if(elapsed*PROFILE_TICK < WINDOW*1000UL || idleRate == 0) return;
+
+        float used = 1.0f - idleCount/(idleRate*elapsed);
+        totalLoad  = constrain(used, 0.0f, 1.0f)*100.0f;
+
+        uint32_t ticks[NUM_SOURCES];
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            for(uint8_t i=0; i<NUM_SOURCES; i++) ticks[i] = isrTicks[i];
+        }
+        for(uint8_t i=0; i<NUM_SOURCES; i++){
+            sourceLoad[i] = (ticks[i] - windowIsrTicks[i])*100.0f/elapsed;
+            windowIsrTicks[i] = ticks[i];
+        }
+
+        idleCount   = 0;
+        windowStart = now;
+    }
+
+    float load(){ return totalLoad; }
+
+    float isrLoad(){
+        float sum = 0;
+        for(uint8_t i=0; i<NUM_SOURCES; i++) sum += sourceLoad[i];
+        return sum;
+    }
+
+    float isrLoad(Source source){ return sourceLoad[source]; }
+}
@@ -0,0 +1,81 @@
+#ifndef CPULOAD_H
+#define CPULOAD_H
+
+#include "Arduino.h"
+#include "util/profile.h"
+
+/**
+ * Measures how much of the processor is in use
+ *
+ * The main loop calls `idle` whenever it has nothing due, which spins
+ *     counting for a while. `calibrate` measures how fast that count goes
+ *     with nothing else running, so every count short of that rate over a
+ *     window is time taken by real work: the main loop, every interrupt and
+ *     the interrupt entry and exit around them. This includes the UART and
+ *     timer interrupts in the Arduino core, which can't be timed directly.
+ * Everything outside `idle` counts as busy, including loop passes that only
+ *     poll and find nothing to do. The load therefore depends on how long
+ *     each `idle` call spins: a shorter spin polls more often and reads
+ *     higher. Compare loads taken with the same idle time.
+ * The library's own interrupt handlers also time themselves with an IsrTimer,
+ *     splitting out how much of the load is spent in each. Handlers that
+ *     enable interrupts, as the servo generator does around its frame
+ *     callback, leave out the time of timed handlers that nest inside them,
+ *     so each tick is counted once.
+ *
+ * The interrupt times are defined in CpuLoad.cpp so handlers compiled in
+ *     other files of the library can add to them.
+ */
+namespace CpuLoad{
+    /** Interrupt handlers that time themselves */
+    enum Source : uint8_t { SERVO_ISR, RADIO_ISR, EEPROM_ISR, TWI_ISR,
+                            NUM_SOURCES };
+    /** Milliseconds the loads are averaged over */
+    const uint16_t WINDOW = 1000;
+
+    /** profileClock ticks spent in each source's handler */
+    extern volatile uint32_t isrTicks[NUM_SOURCES];
+    /** Sum of isrTicks, for finding the time of nested handlers */
+    extern volatile uint32_t timedTicks;
+
+    /**
+     * Times an interrupt handler from its construction to the end of the
+     *     handler's scope; the first line of the handler should create one
+     * Time spent in other timed handlers nested inside is left out.
+     */
+    class IsrTimer{
+        const Source source;
+        const uint32_t start;
+        const uint32_t nestedStart;
+    public:
+        IsrTimer(Source s)
+            : source(s), start(profileClock()), nestedStart(timedTicks) {}
+        ~IsrTimer(){
+            const uint8_t sreg = SREG;
+            cli();
+            const uint32_t nested = timedTicks - nestedStart;
+            const uint32_t ticks  = (profileClock() - start) - nested;
+            isrTicks[source] += ticks;
+            timedTicks += ticks;
+            SREG = sreg;
+        }
+    };
+
+    /**
+     * Measure the idle count rate with interrupts disabled; takes about a
+     *     millisecond. Called once at startup.
+     */
+    void calibrate();
+    /** Count idle time for `microseconds`; call when the loop has no work */
+    void idle(uint16_t microseconds);
+    /** Recompute the loads once a WINDOW has passed; call every loop */
+    void update();
+    /** Percent of the processor used over the last window */
+    float load();
+    /** Percent of the processor spent in the timed interrupt handlers */
+    float isrLoad();
+    /** Percent of the processor spent in one source's handler */
+    float isrLoad(Source source);
+}
+
+#endif
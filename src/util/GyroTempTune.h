@@ -0,0 +1,90 @@
+#ifndef GyroTempTune_H
+#define GyroTempTune_H
+//Gyro Temperature Tune
+// bias(T) = shift + slope*(T-refTemp)
+// G = raw - bias(T)
+//all values are in raw sensor units; temperatures are in celsius
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-pedantic"
+struct GyroTempTune{
+	union{
+		float raw[7];
+		struct {
+			float shift[3];
+			float slope[3];
+			float refTemp;
+		};
+	};
+	GyroTempTune(){
+        shift[0] = 0; shift[1] = 0; shift[2] = 0;
+        slope[0] = 0; slope[1] = 0; slope[2] = 0;
+        refTemp  = 0;
+    }
+    /** The modeled gyroscope bias on `axis` at a temperature of `temp` */
+    inline float bias(uint8_t axis, float temp){
+        return shift[axis] + slope[axis]*(temp-refTemp);
+    }
+    inline void calibrate(float& value, uint8_t axis, float temp){
+        value -= bias(axis, temp);
+    }
+};
+/**
+ * Accumulates still gyroscope readings taken at varying temperatures and
+ * produces the least squares linear fit of bias against temperature.
+ * Temperatures are stored relative to the first sample to keep the sums small
+ */
+class GyroTempFit{
+private:
+    float origin;
+    float n, sT, sTT;
+    float sG[3], sTG[3];
+    float minT, maxT;
+public:
+    GyroTempFit(){ reset(); }
+    void reset(){
+        n = 0; sT = 0; sTT = 0;
+        for(int i=0; i<3; i++){ sG[i] = 0; sTG[i] = 0; }
+    }
+    /** Add an averaged gyroscope reading `gyro` taken at `temp` celsius */
+    void add(float temp, const float (&gyro)[3]){
+        if(n == 0){
+            origin = temp;
+            minT = temp;
+            maxT = temp;
+        }
+        minT = min(minT, temp);
+        maxT = max(maxT, temp);
+
+        float t = temp-origin;
+        n   += 1;
+        sT  += t;
+        sTT += t*t;
+        for(int i=0; i<3; i++){
+            sG[i]  += gyro[i];
+            sTG[i] += t*gyro[i];
+        }
+    }
+    /** Number of readings accumulated so far */
+    uint16_t samples(){ return n; }
+    /** Difference between the hottest and coldest readings in celsius */
+    float span(){ return (n == 0)? 0 : maxT-minT; }
+    /**
+     * Returns the fitted tune, centered on the mean sample temperature
+     * The slope is left at zero if the samples do not span any temperatures
+     */
+    GyroTempTune fit(){
+        GyroTempTune tune;
+        if(n == 0) return tune;
+
+        float meanT = sT/n;
+        float den   = n*sTT - sT*sT;
+        tune.refTemp = meanT + origin;
+        for(int i=0; i<3; i++){
+            tune.shift[i] = sG[i]/n;
+            if(den != 0) tune.slope[i] = (n*sTG[i] - sT*sG[i])/den;
+        }
+        return tune;
+    }
+};
+#pragma GCC diagnostic pop
+#endif
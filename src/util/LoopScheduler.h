@@ -0,0 +1,255 @@
+#ifndef LOOPSCHEDULER_H
+#define LOOPSCHEDULER_H
+
+#include "Arduino.h"
+#include "util/profile.h"
+#include "util/Trace.h"
+
+/**
+ * Runs the periodic work of the main loop from a table of tasks
+ *
+ * Each task declares its period in milliseconds, a phase offset within that
+ *     period and a priority. Every call to `run` starts at most one due task:
+ *     the one with the lowest priority number, then the one waiting longest,
+ *     so a slow task delays the others by a loop iteration instead of every
+ *     task due at once landing in the same iteration.
+ * Release times advance by whole periods from the phase, so rates do not
+ *     drift with loop timing. A task that falls more than a period behind
+ *     skips the releases it missed instead of running back to back.
+ * When no phase is given, one is chosen that keeps the task's releases as far
+ *     as possible from those of the tasks already added.
+ * The runtime of each task and how late it started are recorded for
+ *     reporting, and `statsLine` formats them as text.
+ *
+ * This is the main loop's counterpart to BusScheduler, which runs in the
+ *     control frame interrupt; tasks here are free to be slow and to block.
+ */
+class LoopScheduler{
+public:
+    typedef void (*Task)();
+    /** Maximum number of tasks that can be registered */
+    static const uint8_t MAX_TASKS = 8;
+    /** Pass as the phase to have one chosen */
+    static const uint16_t AUTO_PHASE = 0xffff;
+
+    class Stats{
+    public:
+        Stats(): last(0), longest(0), total(0), latest(0), lateTotal(0),
+                 count(0), skipped(0) {}
+        /** most recent and longest runtime in microseconds */
+        uint16_t last, longest;
+        uint32_t total;
+        /** longest delay in milliseconds from release to start, and its sum */
+        uint16_t latest;
+        uint32_t lateTotal;
+        /** number of runs and number of releases missed entirely */
+        uint16_t count, skipped;
+        uint16_t mean() const { return (count == 0)? 0 : total/count; }
+        uint16_t meanLate() const { return (count == 0)? 0 : lateTotal/count; }
+        void record(uint16_t time, uint16_t late){
+            last = time;
+            if(time > longest) longest = time;
+            if(late > latest) latest = late;
+            total     += time;
+            lateTotal += late;
+            count++;
+            // keep the running means from overflowing
+            if(count == 0xffff){
+                total     /= 2;
+                lateTotal /= 2;
+                count     /= 2;
+            }
+        }
+    };
+private:
+    struct Entry{
+        Task     task;
+        uint16_t period;
+        uint16_t phase;
+        uint8_t  priority;
+        bool     enabled;
+        // millis() of the next release
+        uint32_t next;
+    };
+    Entry entries[MAX_TASKS];
+    Stats taskStats[MAX_TASKS];
+    uint8_t numTasks;
+    bool started;
+    uint32_t startTime;
+    static uint16_t gcd(uint16_t a, uint16_t b){
+        while(b != 0){
+            uint16_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+    uint16_t choosePhase(uint16_t period);
+    /**
+     * Move `e` to its first release at or after `now`
+     * @return the number of releases passed over
+     */
+    static uint16_t catchUp(Entry& e, uint32_t now){
+        if((int32_t)(now - e.next) <= 0) return 0;
+        uint16_t missed = (now - e.next - 1)/e.period + 1;
+        e.next += (uint32_t)missed*e.period;
+        return missed;
+    }
+public:
+    LoopScheduler(): numTasks(0), started(false), startTime(0) {}
+    /**
+     * Register a task
+     * @param  task     Function to run
+     * @param  period   Milliseconds between runs
+     * @param  priority Lower numbers run first when several tasks are due
+     * @param  phase    Milliseconds into the period of the first release, or
+     *                  AUTO_PHASE to have one chosen
+     * @return          the task's index, or -1 if full
+     */
+    int8_t add(Task task, uint16_t period, uint8_t priority = 0,
+               uint16_t phase = AUTO_PHASE);
+    /**
+     * Set the time the phases count from; called once all tasks are added,
+     *     otherwise the first `run` does it
+     */
+    void begin();
+    /**
+     * Run the most urgent due task, if any; call every loop iteration
+     * @return true if a task ran
+     */
+    bool run();
+    /**
+     * Stop or resume releasing task `i`; a resumed task picks up its phase
+     *     again from the next release after now
+     */
+    void enable(uint8_t i, bool on);
+    uint8_t size(){ return numTasks; }
+    /** Period and phase offset in milliseconds of task `i` */
+    uint16_t period(uint8_t i){ return entries[i].period; }
+    uint16_t phase(uint8_t i){ return entries[i].phase; }
+    /** Timing of task `i` */
+    const Stats& getStats(uint8_t i){ return taskStats[i]; }
+    /** Clear all recorded timing */
+    void resetStats();
+    /**
+     * Write a report of task `i` into `buf` as
+     *     "loop<i> n:count avg:mean hi:longest late:latest skip:skipped"
+     *     with runtimes in microseconds and lateness in milliseconds
+     * @param  buf Where to write the report; it is always null terminated
+     * @param  len Size of `buf`
+     * @return     Length of the report; 0 if there is no task `i`
+     */
+    uint8_t statsLine(uint8_t i, char* buf, uint8_t len);
+};
+uint16_t
+LoopScheduler::choosePhase(uint16_t period){
+    // Two tasks release together when their phases match modulo the gcd of
+    // their periods, so pick the phase furthest from that for every task
+    // already added, breaking ties with the total distance. The distances
+    // repeat with the lcm of those gcds, so only phases below it are tried.
+    uint16_t cycle = 1;
+    for(uint8_t i=0; i<numTasks; i++){
+        uint16_t g = gcd(period, entries[i].period);
+        cycle = cycle/gcd(cycle, g)*g;
+    }
+    uint16_t bestPhase = 0;
+    uint16_t bestNear  = 0;
+    uint32_t bestTotal = 0;
+    for(uint16_t p=0; p<cycle; p++){
+        uint16_t near  = 0xffff;
+        uint32_t total = 0;
+        for(uint8_t i=0; i<numTasks; i++){
+            uint16_t g = gcd(period, entries[i].period);
+            uint16_t d = (p + g - entries[i].phase % g) % g;
+            d = min(d, (uint16_t)(g-d));
+            near   = min(near, d);
+            total += d;
+        }
+        if(p == 0 || near > bestNear || (near == bestNear && total > bestTotal)){
+            bestPhase = p;
+            bestNear  = near;
+            bestTotal = total;
+        }
+    }
+    return bestPhase;
+}
+int8_t
+LoopScheduler::add(Task task, uint16_t period, uint8_t priority,
+                   uint16_t phase){
+    if(numTasks >= MAX_TASKS) return -1;
+    if(period < 1) period = 1;
+    phase = (phase == AUTO_PHASE)? choosePhase(period) : phase % period;
+
+    uint8_t i = numTasks;
+    entries[i] = {task, period, phase, priority, true, startTime + phase};
+    numTasks++;
+    return i;
+}
+void
+LoopScheduler::begin(){
+    started   = true;
+    startTime = millis();
+    for(uint8_t i=0; i<numTasks; i++){
+        entries[i].next = startTime + entries[i].phase;
+    }
+}
+bool
+LoopScheduler::run(){
+    if(!started) begin();
+
+    uint32_t now  = millis();
+    int8_t   best = -1;
+    int32_t  bestWait = 0;
+    for(uint8_t i=0; i<numTasks; i++){
+        const Entry& e = entries[i];
+        int32_t wait = now - e.next;
+        if(!e.enabled || wait < 0) continue;
+        if(best == -1 || e.priority < entries[best].priority ||
+           (e.priority == entries[best].priority && wait > bestWait)){
+            best     = i;
+            bestWait = wait;
+        }
+    }
+    if(best == -1) return false;
+
+    Entry& e = entries[best];
+    uint32_t start = micros();
+    Trace::begin(Trace::LOOP_TASK, best);
+    e.task();
+    Trace::end(Trace::LOOP_TASK, best);
+    uint32_t end = micros();
+    taskStats[best].record(min(end-start, 0xffffUL), min(bestWait, 0xffffL));
+
+    e.next += e.period;
+    taskStats[best].skipped += catchUp(e, now);
+    return true;
+}
+void
+LoopScheduler::enable(uint8_t i, bool on){
+    if(i >= numTasks) return;
+    Entry& e = entries[i];
+    if(on && !e.enabled) catchUp(e, millis());
+    e.enabled = on;
+}
+void
+LoopScheduler::resetStats(){
+    for(uint8_t i=0; i<MAX_TASKS; i++) taskStats[i] = Stats();
+}
+uint8_t
+LoopScheduler::statsLine(uint8_t i, char* buf, uint8_t len){
+    if(len == 0) return 0;
+    buf[0] = '\0';
+    if(i >= numTasks) return 0;
+    const Stats& s = taskStats[i];
+    char* p   = buf;
+    char* end = buf + len - 1;
+    p = appendText(p, end, "loop");   p = appendNumber(p, end, i);
+    p = appendText(p, end, " n:");    p = appendNumber(p, end, s.count);
+    p = appendText(p, end, " avg:");  p = appendNumber(p, end, s.mean());
+    p = appendText(p, end, " hi:");   p = appendNumber(p, end, s.longest);
+    p = appendText(p, end, " late:"); p = appendNumber(p, end, s.latest);
+    p = appendText(p, end, " skip:"); p = appendNumber(p, end, s.skipped);
+    *p = '\0';
+    return p - buf;
+}
+#endif
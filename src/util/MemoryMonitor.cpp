@@ -0,0 +1,94 @@
+#include "MemoryMonitor.h"
+
+using namespace MemoryMonitor;
+
+#if defined(__AVR__)
+
+// start of the heap and its current top, from the linker and malloc
+extern uint8_t  __heap_start;
+extern uint8_t* __brkval;
+
+namespace {
+    // random after a power up, so a match means the last run left it
+    constexpr uint32_t RECORD_VALID = 0x57AC4ED5;
+
+    // kept out of .bss so it is neither cleared at boot nor painted over
+    struct BootRecord{
+        // only set once a scan has found the top of the heap, because the
+        // constructors and setup allocate from the heap after painting
+        uint32_t valid;
+        // top of the heap at the last scan
+        uint8_t* heapTop;
+        // stack headroom the run before this one ended with
+        uint16_t lastRunHeadroom;
+    } bootRecord __attribute__((section(".noinit")));
+
+    uint8_t* lowWater = (uint8_t*)RAMEND;
+    uint8_t* highestHeap = &__heap_start;
+    uint32_t lastScan;
+
+    inline uint8_t* heapTop(){
+        return (__brkval == NULL)? &__heap_start : __brkval;
+    }
+}
+
+// Runs from .init3, after the stack pointer is set up and before static
+// variables are initialized, so it can only use registers and .noinit memory.
+// Nothing is on the stack yet, so all of it can be painted.
+void paintMemory() __attribute__((naked, used, section(".init3")));
+void paintMemory(){
+    uint8_t* const end = (uint8_t*)RAMEND;
+    uint16_t headroom = UNKNOWN;
+    uint8_t* p = bootRecord.heapTop;
+    if(bootRecord.valid == RECORD_VALID && p >= &__heap_start && p <= end){
+        while(p <= end && *p == PAINT) p++;
+        headroom = p - bootRecord.heapTop;
+    }
+    bootRecord.valid = 0;
+    bootRecord.lastRunHeadroom = headroom;
+    for(p = &__heap_start; p <= end; p++) *p = PAINT;
+}
+
+namespace MemoryMonitor{
+    bool update(){
+        if(millis() - lastScan < SCAN_PERIOD) return false;
+        lastScan = millis();
+
+        uint8_t* top = heapTop();
+        if(top > highestHeap) highestHeap = top;
+        // the low-water mark only moves down; nothing above it needs a look
+        uint8_t* p = top;
+        while(p < lowWater && *p == PAINT) p++;
+        lowWater = p;
+        bootRecord.heapTop = top;
+        bootRecord.valid = RECORD_VALID;
+        return true;
+    }
+
+    uint16_t stackHeadroom(){
+        uint8_t* top = heapTop();
+        return (lowWater > top)? lowWater - top : 0;
+    }
+
+    uint16_t freeMemory(){
+        uint8_t* top = heapTop();
+        uint8_t* sp  = (uint8_t*)SP;
+        return (sp > top)? sp - top : 0;
+    }
+
+    uint16_t heapSize(){ return highestHeap - &__heap_start; }
+
+    uint16_t lastRunHeadroom(){ return bootRecord.lastRunHeadroom; }
+}
+
+#else
+
+namespace MemoryMonitor{
+    bool update(){ return false; }
+    uint16_t stackHeadroom(){ return UNKNOWN; }
+    uint16_t freeMemory(){ return UNKNOWN; }
+    uint16_t heapSize(){ return 0; }
+    uint16_t lastRunHeadroom(){ return UNKNOWN; }
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef MEMORYMONITOR_H
+#define MEMORYMONITOR_H
+
+#include "Arduino.h"
+
+/**
+ * Measures how close the stack has come to the heap
+ *
+ * At boot, before any constructors run, all memory above the static variables
+ *     is painted with a known byte. The stack overwrites that paint as it
+ *     grows down, and the heap as it grows up. `update` scans up from the top
+ *     of the heap for the first byte that isn't paint. That gives the stack's
+ *     low-water mark, and the bytes between it and the heap are headroom the
+ *     stack has never used.
+ * The paint and the top of the heap survive a reset that keeps power, such
+ *     as the watchdog or the reset button. The next boot scans them before
+ *     painting again, so the headroom left when a run ended in a crash is
+ *     still known; 0 means the stack ran into the heap. The bootloader can
+ *     overwrite some of that memory, so the figure is only a guide.
+ *
+ * Painting and the boot scan are in MemoryMonitor.cpp and run at every boot;
+ *     together they take a couple of milliseconds.
+ */
+namespace MemoryMonitor{
+    /** Byte the free memory is painted with */
+    const uint8_t PAINT = 0xA5;
+    /** Returned for measurements that aren't available */
+    const uint16_t UNKNOWN = 0xffff;
+    /** Milliseconds between scans */
+    const uint16_t SCAN_PERIOD = 1000;
+
+    /**
+     * Scan for the stack's low-water mark if SCAN_PERIOD has passed since
+     *     the last scan; call every loop
+     * Each scan also notes the top of the heap for the next boot to scan from
+     * @return true if a scan was made
+     */
+    bool update();
+    /** Bytes between the heap and the deepest the stack has reached */
+    uint16_t stackHeadroom();
+    /** Bytes between the heap and the stack right now */
+    uint16_t freeMemory();
+    /** Largest size the heap has reached in bytes */
+    uint16_t heapSize();
+    /**
+     * The stack headroom left when the last run ended, or UNKNOWN if this
+     *     boot followed a power up or the last run reset before its first scan
+     */
+    uint16_t lastRunHeadroom();
+}
+
+#endif
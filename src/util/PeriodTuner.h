@@ -0,0 +1,120 @@
+#ifndef PERIODTUNER_H
+#define PERIODTUNER_H
+
+#include "Arduino.h"
+#include "APM/ServoGenerator.h"
+
+/**
+ * Picks the shortest control frame period a build can sustain
+ *
+ * The update callback's timing is sampled from a ServoGenerator every
+ *     SAMPLE_TIME milliseconds. The period it needs is
+ *         longest callback * (1 + margin) + OUTPUT_ROOM
+ *     so the pulses still fit after the callback finishes, and at least
+ *         mean callback / MAX_LOAD
+ *     so the main loop keeps some processor time.
+ * While shortening is allowed (the motors are stopped) the period is moved
+ *     down to the larger of the two. At any time, a skipped frame or a
+ *     callback eating into the margin makes the period longer. Each back off
+ *     also becomes the new floor, so the period doesn't bounce back into
+ *     trouble.
+ * Period changes are applied at a frame boundary, so no pulse is cut short
+ */
+class PeriodTuner{
+public:
+    /** Milliseconds of callback timing gathered for each decision */
+    static const uint16_t SAMPLE_TIME = 500;
+    /** Microseconds left after the callback for the longest output pulse */
+    static const uint16_t OUTPUT_ROOM = 2600;
+    /** Largest share of the processor the callback may use on average */
+    constexpr static float MAX_LOAD = 0.5f;
+    /** Factor the period grows by on each back off */
+    constexpr static float BACKOFF = 1.25f;
+private:
+    ServoGenerator::Generator& generator;
+    float    margin;
+    uint16_t shortest, longest;
+    uint16_t floor;
+    uint16_t start, current;
+    uint32_t lastSample;
+    uint16_t required(const ServoGenerator::FrameStats& stats);
+public:
+    PeriodTuner(ServoGenerator::Generator& gen = ServoGenerator::primary())
+        : generator(gen), margin(0), shortest(0), longest(0), floor(0),
+          start(0), current(0), lastSample(0) {}
+    /**
+     * Start tuning from `period`, never going outside [shortest, longest]
+     * @param period   The starting period in microseconds
+     * @param shortest The shortest period the outputs can accept
+     * @param longest  The longest period to back off to, if longer than
+     *                 `period`
+     */
+    void begin(uint16_t period, uint16_t shortest, uint16_t longest);
+    /**
+     * Set the extra callback time to keep in reserve, as a fraction of the
+     *     longest callback measured; 0 turns tuning off and goes back to the
+     *     starting period
+     */
+    void setMargin(float m);
+    bool enabled(){ return margin > 0.0f; }
+    /** The period last chosen in microseconds */
+    uint16_t period(){ return current; }
+    /**
+     * Sample the callback timing and adjust the period; call frequently
+     * @param mayShorten True when the period may be shortened, i.e. while
+     *                   the motors are stopped
+     */
+    void update(bool mayShorten);
+};
+void
+PeriodTuner::begin(uint16_t period, uint16_t shortestPeriod,
+                   uint16_t longestPeriod){
+    shortest   = shortestPeriod;
+    longest    = max(longestPeriod, period);
+    floor      = shortest;
+    start      = period;
+    current    = period;
+    lastSample = millis();
+    generator.frameStats(true);
+}
+void
+PeriodTuner::setMargin(float m){
+    bool wasEnabled = enabled();
+    margin = max(m, 0.0f);
+    if(wasEnabled && !enabled() && current != start){
+        current = start;
+        generator.setInterval(current);
+    }
+}
+uint16_t
+PeriodTuner::required(const ServoGenerator::FrameStats& stats){
+    float need = stats.longest * (1.0f + margin) + OUTPUT_ROOM;
+    need = max(need, stats.mean / MAX_LOAD);
+    return min(need, 65535.0f);
+}
+void
+PeriodTuner::update(bool mayShorten){
+    if(!enabled() || current == 0) return;
+    if(millis() - lastSample < SAMPLE_TIME) return;
+    lastSample = millis();
+
+    ServoGenerator::FrameStats stats = generator.frameStats(true);
+    // samples taken across a period change are not trusted
+    if(stats.period != current) return;
+
+    uint16_t need = required(stats);
+    uint16_t next = current;
+    if(stats.skipped > 0 || need > current){
+        next  = max((float)need, current*BACKOFF);
+        floor = min(next, longest);
+    } else if(mayShorten){
+        next = max(need, floor);
+    }
+    next = constrain(next, shortest, longest);
+
+    if(next != current){
+        current = next;
+        generator.setInterval(current);
+    }
+}
+#endif
@@ -0,0 +1,116 @@
+#ifndef SETPOINTSHAPER_H
+#define SETPOINTSHAPER_H
+
+#include "Arduino.h"
+#include "math/SpatialMath.h"
+
+/**
+ * Stick response curve, expo blended with a linear response and scaled by
+ *     a rate, looked up from a table built whenever the curve changes
+ * out = rate * ((1-expo)*x + expo*x^3), for x in [-1,1]
+ */
+class ExpoCurve{
+public:
+    /** Number of table points across [0,1]; the curve is odd symmetric */
+    static const uint8_t POINTS = 17;
+private:
+    float table[POINTS];
+public:
+    ExpoCurve(){ set(0.0f, 1.0f); }
+    /**
+     * Rebuild the table
+     * @param expo 0 for a linear response, up to 1 for a cubic one
+     * @param rate output at full stick
+     */
+    void set(float expo, float rate){
+        expo = constrain(expo, 0.0f, 1.0f);
+        for(uint8_t i=0; i<POINTS; i++){
+            float x = ((float)i)/(POINTS-1);
+            table[i] = rate*((1.0f-expo)*x + expo*x*x*x);
+        }
+    }
+    /** Apply the curve to a stick position in [-1,1] */
+    float apply(float x) const {
+        bool negative = (x < 0);
+        if(negative) x = -x;
+        if(x >= 1.0f) return negative? -table[POINTS-1] : table[POINTS-1];
+        float pos  = x*(POINTS-1);
+        uint8_t i  = (uint8_t)pos;
+        float frac = pos - i;
+        float y    = table[i] + (table[i+1]-table[i])*frac;
+        return negative? -y : y;
+    }
+};
+
+/**
+ * Smooths a setpoint that is updated slower than the control loop reads it
+ * The main loop calls `set` each time it has a new target; the control loop
+ *     calls `update` every frame, which moves linearly from the old target to
+ *     the new one over the time that passed between the last two `set`s. The
+ *     slope of that ramp is available from `rate` as a feed-forward term.
+ * If the control loop has not run since the last `set` the new target is
+ *     taken immediately, so a paused control loop never resumes with a jump
+ *     compressed into a short ramp
+ * `set` may be interrupted by `update`, so it must be called with interrupts
+ *     disabled
+ */
+class SetpointShaper{
+public:
+    /** Longest ramp in milliseconds, used if the targets stop coming */
+    constexpr static float MAX_SPAN = 50.0f;
+private:
+    // angular setpoints wrap at +/- PI and ramp the short way around
+    const bool angular;
+    float from, to, current;
+    // milliseconds of control frames since the ramp started, and its length
+    float elapsed, span;
+    // milliseconds of control frames since the last `set`
+    float sinceSet;
+    float slope;
+    float difference(float a, float b){
+        return angular? distanceRadian(a, b) : b-a;
+    }
+public:
+    SetpointShaper(bool angular = false)
+        : angular(angular), from(0), to(0), current(0), elapsed(0), span(0),
+          sinceSet(0), slope(0) {}
+    /** Start a ramp from the current value to `target` */
+    void set(float target){
+        if(sinceSet == 0){
+            from = to = current = angular? truncateRadian(target) : target;
+            return;
+        }
+        span     = min(sinceSet, MAX_SPAN);
+        sinceSet = 0;
+        elapsed  = 0;
+        from     = current;
+        to       = from + difference(from, target);
+    }
+    /** Finish the ramp now; the next target is also taken immediately */
+    void reset(){
+        from = current = angular? truncateRadian(to) : to;
+        to       = from;
+        elapsed  = span = sinceSet = 0;
+        slope    = 0;
+    }
+    /**
+     * Advance the ramp by one control frame
+     * @param  ms milliseconds since the last update
+     * @return    The smoothed setpoint
+     */
+    float update(float ms){
+        sinceSet += ms;
+        elapsed  += ms;
+        float next = (elapsed >= span)? to : from + (to-from)*(elapsed/span);
+        if(angular) next = truncateRadian(next);
+        slope   = (ms > 0)? difference(current, next)*1000.0f/ms : 0;
+        current = next;
+        return current;
+    }
+    /** The smoothed setpoint from the last update */
+    float get(){ return current; }
+    /** Change of the setpoint per second over the last update */
+    float rate(){ return slope; }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "Trace.h"
+
+namespace Trace{
+    Record buffer[CAPACITY];
+    volatile uint8_t head, tail;
+    volatile uint8_t dropped;
+    volatile Mode mode;
+    volatile bool holding;
+
+    namespace {
+        inline uint8_t following(uint8_t i){ return (i + 1) & (CAPACITY - 1); }
+        inline void write(uint8_t i, uint8_t id, uint8_t data){
+            buffer[i].id   = id;
+            buffer[i].data = data;
+            buffer[i].time = clock();
+        }
+    }
+
+    void put(uint8_t id, uint8_t data){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            uint8_t h = head;
+            // a DROPPED record goes first if any were lost, so that and this
+            // one both need room
+            const uint8_t room = (tail - h - 1) & (CAPACITY - 1);
+            if(holding || room < ((dropped != 0)? 2 : 1)){
+                if(dropped != 0xff) dropped++;
+                if(mode == ONE_SHOT) holding = true;
+                return;
+            }
+            if(dropped != 0){
+                write(h, DROPPED | INSTANT, dropped);
+                dropped = 0;
+                h = following(h);
+            }
+            write(h, id, data);
+            head = following(h);
+        }
+    }
+
+    void setMode(Mode m){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            mode = m;
+            holding = false;
+        }
+    }
+
+    uint8_t pack(uint8_t* buf, uint8_t len){
+        uint8_t n = 0;
+        // only this reads, so tail can't move; `put` never writes at tail
+        // while there are records left to read
+        uint8_t t = tail;
+        while(n + RECORD_SIZE <= len && t != head){
+            const Record& r = buffer[t];
+            buf[n++] = r.id;
+            buf[n++] = r.data;
+            buf[n++] = r.time >> 8;
+            buf[n++] = r.time & 0xff;
+            t = following(t);
+        }
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            tail = t;
+            // a one shot capture has been sent in full; take the next one
+            if(holding && t == head) holding = false;
+        }
+        return n;
+    }
+}
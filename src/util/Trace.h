@@ -0,0 +1,121 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "Arduino.h"
+#include <util/atomic.h>
+#include "util/profile.h"
+
+/**
+ * Event trace for seeing how interrupts and the main loop interleave
+ *
+ * Each record is 4 bytes: an event id, a byte of data and a 16 bit timestamp
+ *     in profileClock ticks (4us at 16MHz, wrapping every 262ms). Records are
+ *     put in a ring buffer from anywhere, interrupts included, in a few dozen
+ *     cycles. `pack` takes them back out for sending, normally over the
+ *     comm link in whatever bandwidth the telemetry leaves spare.
+ * When the buffer is full new records are dropped and counted. The next
+ *     record that fits is preceded by a DROPPED record holding the count, so
+ *     a reader knows the time between the two is unknown.
+ * The instrumented events come far faster than a 9600 baud link can carry,
+ *     so CONTINUOUS tracing mostly drops. ONE_SHOT fills the buffer, stops
+ *     recording until it has all been packed, then starts again, giving a
+ *     series of complete snapshots instead.
+ * The top two bits of an id give its phase: an instant, or the beginning or
+ *     end of a span. Spans of the same event must nest.
+ * Nothing is recorded until a mode is set.
+ *
+ * extras/trace2chrome.py converts a capture of the comm link into Chrome
+ *     trace JSON for viewing as a timeline; its event names follow `Event`.
+ * The buffer is defined in Trace.cpp so interrupt handlers in the library's
+ *     other .cpp files can record into it.
+ */
+namespace Trace{
+    enum Phase : uint8_t { INSTANT = 0x00, BEGIN = 0x40, END = 0x80 };
+    const uint8_t PHASE_MASK = 0xC0;
+    /** Ids for the library's events; sketches can use USER and above */
+    enum Event : uint8_t {
+        /** records were lost just before this one; data is how many */
+        DROPPED       = 0,
+        /** servo generator frame start; data is the low byte of its number */
+        SERVO_FRAME   = 1,
+        /** servo generator frame callback, the control loop, as a span */
+        FRAME_CALLBACK= 2,
+        /** BusScheduler task as a span; data is the task index */
+        BUS_TASK      = 3,
+        /** LoopScheduler task as a span; data is the task index */
+        LOOP_TASK     = 4,
+        /** message received by CommManager; data is its label */
+        COMM_MESSAGE  = 5,
+        /** EEPROM byte written; data is the low byte of the address */
+        EEPROM_WRITE  = 6,
+        /** radio frame completed; data is its channel count */
+        RADIO_FRAME   = 7,
+        USER          = 32
+    };
+    /** How records are kept; also the TRACE_ENABLE command's argument */
+    enum Mode : uint8_t { OFF = 0, CONTINUOUS = 1, ONE_SHOT = 2 };
+    /** Number of records the buffer holds; a power of 2 */
+    const uint8_t CAPACITY = 64;
+    /** Bytes `pack` writes per record */
+    const uint8_t RECORD_SIZE = 4;
+
+    class Record{
+    public:
+        uint8_t  id;
+        uint8_t  data;
+        uint16_t time;
+    };
+
+    extern Record buffer[CAPACITY];
+    // written by `record` at head and read by `pack` from tail
+    extern volatile uint8_t head, tail;
+    extern volatile uint8_t dropped;
+    extern volatile Mode mode;
+    // set in ONE_SHOT mode once the buffer fills, until it is emptied
+    extern volatile bool holding;
+
+    /** Low 16 bits of profileClock; must be called with interrupts off */
+    inline uint16_t clock(){
+    #if defined(__AVR__)
+        uint8_t count = TCNT0;
+        // only the low byte of the overflow count is needed
+        uint8_t overflows = *(volatile uint8_t*)&timer0_overflow_count;
+        if((TIFR0 & _BV(TOV0)) && count < 255) overflows++;
+        return (overflows << 8) | count;
+    #else
+        return profileClock();
+    #endif
+    }
+    /** Add a record to the buffer; use `record` instead */
+    void put(uint8_t id, uint8_t data);
+    inline void record(uint8_t id, uint8_t data){
+        if(mode != OFF) put(id, data);
+    }
+    /** Record an instant event */
+    inline void mark(uint8_t event, uint8_t data = 0){
+        record(event | INSTANT, data);
+    }
+    /** Record the start of a span */
+    inline void begin(uint8_t event, uint8_t data = 0){
+        record(event | BEGIN, data);
+    }
+    /** Record the end of a span */
+    inline void end(uint8_t event, uint8_t data = 0){
+        record(event | END, data);
+    }
+
+    /**
+     * Start recording in `mode`, or stop with OFF; stopping keeps what is
+     *     already recorded
+     */
+    void setMode(Mode mode);
+    /**
+     * Take records out of the buffer to send
+     * @param  buf Filled with records as id, data and big endian time
+     * @param  len Size of `buf`
+     * @return     Bytes written to `buf`; 0 if there was nothing to take
+     */
+    uint8_t pack(uint8_t* buf, uint8_t len);
+}
+
+#endif
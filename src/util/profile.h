@@ -4,28 +4,188 @@
 #include "Arduino.h"
 #include "util/atomic.h"
 
+/**
+ * Timing slots for finding where time goes, in the main loop or interrupts
+ * `tic(i)` marks a start and `toc(i)` records the time since into slot i,
+ *     which keeps the last, shortest, longest and mean time, the number of
+ *     measurements and a histogram of them. Histogram bucket b counts times
+ *     from 2^b up to 2^(b+1) microseconds, so rare outliers stand out next to
+ *     the usual times instead of vanishing into an average.
+ * Slots given a name with `profileName` are included in reports built with
+ *     `profileLine`.
+ * With DEBUG off the slots compile to nothing; `profileClock` is always
+ *     available as a cheap timestamp.
+ */
+namespace{
+    const int NUM_PROFILES = 8;
+}
+
+#if defined(__AVR__)
+    extern volatile unsigned long timer0_overflow_count;
+    /** microseconds per profileClock tick */
+    const uint8_t PROFILE_TICK = 64/clockCyclesPerMicrosecond();
+    /**
+     * The free running timer0 count that micros() is built from, read
+     * inline and left in its 4us ticks at 16MHz
+     */
+    uint32_t __attribute__((always_inline)) inline profileClock(){
+        uint8_t sreg = SREG;
+        cli();
+        uint32_t overflows = timer0_overflow_count;
+        uint8_t  count = TCNT0;
+        // an overflow that hasn't been handled yet
+        if((TIFR0 & _BV(TOV0)) && count < 255) overflows++;
+        SREG = sreg;
+        return (overflows << 8) | count;
+    }
+#else
+    const uint8_t PROFILE_TICK = 1;
+    uint32_t inline profileClock(){ return micros(); }
+#endif
+
+// text building for report lines, here and in the schedulers' reports
+namespace{
+    inline char* appendText(char* p, char* end, const char* text){
+        while(*text != '\0' && p < end) *p++ = *text++;
+        return p;
+    }
+    inline char* appendNumber(char* p, char* end, uint32_t v){
+        char digits[10];
+        uint8_t n = 0;
+        do{
+            digits[n++] = '0' + v%10;
+            v /= 10;
+        } while(v != 0);
+        while(n > 0 && p < end) *p++ = digits[--n];
+        return p;
+    }
+}
+
 #if DEBUG
+    class ProfileSlot{
+    public:
+        static const uint8_t BUCKETS = 16;
+        const char* name;
+        /** all times in microseconds */
+        uint32_t last, shortest, longest, total;
+        uint16_t count;
+        uint16_t histogram[BUCKETS];
+        uint32_t mean() const { return (count == 0)? 0 : total/count; }
+        void record(uint32_t time){
+            last = time;
+            if(count == 0 || time < shortest) shortest = time;
+            if(time > longest) longest = time;
+            uint8_t bucket = 0;
+            for(uint32_t v = time >> 1; v != 0 && bucket < BUCKETS-1; v >>= 1){
+                bucket++;
+            }
+            total += time;
+            count++;
+            histogram[bucket]++;
+            // halve everything together to keep the mean and the histogram's
+            // shape once the counts fill up
+            if(count == 0xffff || histogram[bucket] == 0xffff){
+                total /= 2;
+                count /= 2;
+                for(uint8_t b=0; b<BUCKETS; b++) histogram[b] /= 2;
+            }
+        }
+        void reset(){
+            last = shortest = longest = total = 0;
+            count = 0;
+            for(uint8_t b=0; b<BUCKETS; b++) histogram[b] = 0;
+        }
+    };
+
     namespace{
-        const int NUM_PROFILES = 16;
-        volatile uint32_t profile[NUM_PROFILES];
+        ProfileSlot profile[NUM_PROFILES];
+        // profileClock() at each slot's last tic, and which slots have one
+        uint32_t profileStart[NUM_PROFILES];
+        bool     profileRunning[NUM_PROFILES];
     }
+
     void __attribute__((always_inline)) inline tic(uint8_t i){
-    	profile[i] = -micros();
+        profileStart[i] = profileClock();
+        profileRunning[i] = true;
     }
     void __attribute__((always_inline)) inline toc(uint8_t i){
-    	profile[i] += micros();
+        uint32_t end = profileClock();
+        if(!profileRunning[i]) return;
+        profile[i].record((end - profileStart[i])*PROFILE_TICK);
     }
+    /** The last time recorded in slot `i` in microseconds */
     uint32_t inline profileTime(uint8_t i){
         uint32_t v;
         ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
-            v = profile[i];
+            v = profile[i].last;
         }
         return v;
     }
+    /** Name slot `i` so it is reported; `name` must outlive the slot */
+    void inline profileName(uint8_t i, const char* name){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            profile[i].name = name;
+        }
+    }
+    /** A consistent copy of slot `i` */
+    ProfileSlot inline profileStats(uint8_t i){
+        ProfileSlot s;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            s = profile[i];
+        }
+        return s;
+    }
+    /** Clear the times recorded in every slot, keeping their names */
+    void inline profileReset(){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            for(uint8_t i=0; i<NUM_PROFILES; i++) profile[i].reset();
+        }
+    }
+
+    /**
+     * Write a report of slot `i` into `buf` as
+     *     "name n:count lo:shortest avg:mean hi:longest h:b0,b1,...,b15"
+     *     with times in microseconds and trailing empty buckets left off
+     * @param  i   The slot
+     * @param  buf Where to write the report; it is always null terminated
+     * @param  len Size of `buf`; 160 bytes fits any report for a name of up
+     *             to 10 characters
+     * @return     Length of the report, 0 for an unnamed slot
+     */
+    uint8_t profileLine(uint8_t i, char* buf, uint8_t len){
+        if(len == 0) return 0;
+        ProfileSlot s = profileStats(i);
+        if(s.name == NULL){
+            buf[0] = '\0';
+            return 0;
+        }
+        char* p   = buf;
+        char* end = buf + len - 1;
+        p = appendText(p, end, s.name);
+        p = appendText(p, end, " n:");   p = appendNumber(p, end, s.count);
+        p = appendText(p, end, " lo:");  p = appendNumber(p, end, s.shortest);
+        p = appendText(p, end, " avg:"); p = appendNumber(p, end, s.mean());
+        p = appendText(p, end, " hi:");  p = appendNumber(p, end, s.longest);
+        p = appendText(p, end, " h:");
+        uint8_t used = ProfileSlot::BUCKETS;
+        while(used > 1 && s.histogram[used-1] == 0) used--;
+        for(uint8_t b=0; b<used; b++){
+            if(b != 0) p = appendText(p, end, ",");
+            p = appendNumber(p, end, s.histogram[b]);
+        }
+        *p = '\0';
+        return p - buf;
+    }
 #else
-    void tic(uint8_t i) {}
-    void toc(uint8_t i) {}
-    uint32_t profileTime(uint8_t i) { return 0; }
+    inline void tic(uint8_t i) {}
+    inline void toc(uint8_t i) {}
+    inline uint32_t profileTime(uint8_t i) { return 0; }
+    inline void profileName(uint8_t i, const char* name) {}
+    inline void profileReset() {}
+    inline uint8_t profileLine(uint8_t i, char* buf, uint8_t len){
+        if(len != 0) buf[0] = '\0';
+        return 0;
+    }
 #endif
 
 #endif